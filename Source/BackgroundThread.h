@@ -0,0 +1,24 @@
+/*
+  ==============================================================================
+
+    BackgroundThread.h
+    One worker thread shared by every instance in the process.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/** A TimeSliceThread for the non-real-time work of every Echidna instance, such
+    as analyser FFTs and linear-phase kernel design. Hold it through a
+    juce::SharedResourcePointer, so that hundreds of instances in a session
+    still only start one thread, and it stops when the last instance goes.
+*/
+struct SharedBackgroundThread  : public juce::TimeSliceThread
+{
+    SharedBackgroundThread() : juce::TimeSliceThread("Echidna background") { startThread(); }
+    ~SharedBackgroundThread() override { stopThread(1000); }
+};
@@ -0,0 +1,79 @@
+/*
+  ==============================================================================
+
+    BandSnapshot.h
+    Stored values of every band parameter, and blending between two sets.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+// Per-band parameter slots, in the same order as EQBandParameters.
+enum EQBandParameterIndex
+{
+    gainCurrentIndex = 0,
+    gainSpeedIndex,
+    gainMinIndex,
+    gainMaxIndex,
+    gainDirectionIndex,
+    freqCurrentIndex,
+    freqSpeedIndex,
+    freqMinIndex,
+    freqMaxIndex,
+    freqDirectionIndex,
+    QIndex,
+    typeIndex,
+    dynamicIndex,
+    thresholdIndex,
+    ratioIndex,
+    attackIndex,
+    releaseIndex,
+    numEQBandParameters
+};
+
+//==============================================================================
+/** The plain values of every band parameter, as a fixed-size block that can be
+    copied between threads and written to a preset without allocating.
+*/
+template <int NumBands>
+struct BandSnapshot
+{
+    float values[NumBands][numEQBandParameters] {};
+
+    float get(int band, int index) const { return values[band][index]; }
+
+    /** A value part way from start to end. Frequencies, Q, speeds, ratios and
+        times are blended on a log scale so that a morph sweeps evenly in
+        octaves, gains, thresholds and directions linearly, and the band type
+        and dynamics switch over at the halfway point.
+    */
+    static float interpolate(int index, float start, float end, float position)
+    {
+        switch (index)
+        {
+        case typeIndex:
+        case dynamicIndex:
+            return position < 0.5f ? start : end;
+        case freqCurrentIndex:
+        case freqMinIndex:
+        case freqMaxIndex:
+        case freqSpeedIndex:
+        case gainSpeedIndex:
+        case QIndex:
+        case ratioIndex:
+        case attackIndex:
+        case releaseIndex:
+            if (start > 0.0f && end > 0.0f)
+                return start * std::pow(end / start, position);
+
+            break;
+        default:
+            break;
+        }
+
+        return start + (end - start) * position;
+    }
+};
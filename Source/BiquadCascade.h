@@ -0,0 +1,542 @@
+/*
+  ==============================================================================
+
+    BiquadCascade.h
+    Transposed direct form II biquad state and processing.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "BiquadDesigner.h"
+
+/** One SIMD register of samples, one channel per lane. */
+template <typename SampleType>
+using ChannelLanes = juce::dsp::SIMDRegister<SampleType>;
+
+/** Runs body(k) for each stage as straight-line code, so a chain is unrolled
+    however the compiler weighs up the loop.
+*/
+template <typename Body, int... Stages>
+inline void unrolled(Body&& body, std::integer_sequence<int, Stages...>)
+{
+    (body(Stages), ...);
+}
+
+//==============================================================================
+/** Delay line of a single biquad. StateType is either a plain sample type or
+    a SIMD register holding the state of several channels side by side.
+*/
+template <typename StateType>
+struct BiquadState
+{
+    StateType s1 {}, s2 {};
+
+    void reset()
+    {
+        s1 = StateType();
+        s2 = StateType();
+    }
+};
+
+/** One sample through one biquad, transposed direct form II like
+    juce::dsp::IIR::Filter. With a SIMD StateType every lane runs the same
+    coefficients on its own channel.
+*/
+template <typename StateType, typename CoefficientType>
+inline StateType processBiquad(const BiquadCoefficients<CoefficientType>& c, BiquadState<StateType>& state, StateType input)
+{
+    const StateType output = input * c.b0 + state.s1;
+    state.s1 = input * c.b1 - output * c.a1 + state.s2;
+    state.s2 = input * c.b2 - output * c.a2;
+    return output;
+}
+
+//==============================================================================
+/** A fixed chain of biquads processed as one kernel.
+
+    Stages can be switched off when they are transparent. Switching is faded
+    over a few milliseconds by mixing each stage's output with its input, and a
+    fully faded-out stage costs nothing at all.
+
+    While nothing is fading, process() hands the enabled stages to a kernel
+    specialised on how many there are. The kernel copies every coefficient
+    (already broadcast across the lanes) and every delay line into locals, runs
+    the whole slice through the chain with a fully unrolled inner loop, and only
+    writes the states back at the end. That avoids a load and store of each
+    band's state, and a reload of its coefficients, for every sample.
+
+    Channels are split into groups of one register's worth, each with its own
+    delay lines, and the kernel runs two groups per pass where there are enough
+    channels. The two groups share the broadcast coefficients and their
+    recursions are independent, so each one fills the other's latency and eight
+    float channels cost little more than four.
+
+    New designs can also be ramped in rather than switched. startRamp() moves
+    every stage's coefficients in a straight line from where they are to the
+    ones in coefficients[], and the kernel then adds a step to each coefficient
+    on every sample. The denominators a stable biquad can have, |a2| < 1 and
+    |a1| < 1 + a2, form a triangle, and a triangle is convex: every point on a
+    line between two stable designs is itself stable. The ends are kept
+    strictly inside it, so the filter is stable at every sample of the ramp.
+
+    That alone says nothing about the coefficients moving, and a direct form
+    thrown across the spectrum every few samples can pump energy into its
+    delay lines faster than it decays. So the poles are also kept moving
+    gradually: a ramp is stretched until its poles travel, on average, no
+    more than 1/maxRampSamples of the unit disc's radius, or of a half turn
+    around it, per sample. No pole can go further than the radius or half a
+    turn, so any move arrives within
+    maxRampSamples, about 11 ms at 48 kHz, and drift and ordinary automation
+    arrive within the tick that asked for them. Starting a ramp towards the
+    designs it is already heading for carries on with it rather than putting
+    the arrival off. The tests in Tools/Tests check that a jump across the
+    whole spectrum arrives in time, and that modulation which blows up a
+    direct form switched straight to each design stays within the gain the
+    designs themselves can reach. The SVF topology, whose states can't gain
+    energy however its coefficients move, has no such limit.
+
+    SampleType sets the precision of the samples, coefficients and delay lines
+    alike. A double cascade has half as many lanes per register.
+*/
+template <typename SampleType, int NumStages>
+struct BiquadCascade
+{
+    using Lanes = ChannelLanes<SampleType>;
+
+    static constexpr int maxChannels = 16;
+    static constexpr int numLanes = (int) Lanes::SIMDNumElements;
+    static constexpr int maxGroups = (maxChannels + numLanes - 1) / numLanes;
+
+    // No pole moves further per sample than 1/maxRampSamples of the way across
+    // the unit disc, in radius or in angle, so every ramp arrives within this
+    // many samples.
+    static constexpr int maxRampSamples = 512;
+
+    // The delay lines come first and both arrays start on a cache line, so the
+    // kernel's loads and stores never straddle one. The coefficients are the
+    // ones to ramp to, or to use straight away while nothing is ramping.
+    alignas (64) BiquadState<Lanes> states[maxGroups][NumStages];
+    alignas (64) BiquadCoefficients<SampleType> coefficients[NumStages];
+
+    void prepare(double sampleRate)
+    {
+        fadeIncrement = 1.0f / (float) juce::jmax(1, juce::roundToInt(sampleRate * fadeSeconds));
+
+        for (int i = 0; i < NumStages; ++i)
+        {
+            enabled[i] = true;
+            mix[i] = 1.0f;
+        }
+
+        reset();
+        snapToTargets();
+    }
+
+    void reset()
+    {
+        for (auto& group : states)
+            for (auto& state : group)
+                state.reset();
+    }
+
+    /** Switches straight to the designs in coefficients[], for when there is
+        nothing sensible to ramp from.
+    */
+    void snapToTargets()
+    {
+        for (int i = 0; i < NumStages; ++i)
+        {
+            BiquadDesigner::limitStability(coefficients[i]);
+            current[i] = coefficients[i];
+            step[i] = {};
+        }
+
+        rampSamplesRemaining = 0;
+    }
+
+    /** Starts every stage moving towards the designs in coefficients[], arriving
+        numSamples from now, or as much later as the pole speed limit needs.
+    */
+    void startRamp(int numSamples)
+    {
+        numSamples = juce::jmax(1, numSamples);
+
+        for (int i = 0; i < NumStages; ++i)
+            BiquadDesigner::limitStability(coefficients[i]);
+
+        // Restarting towards the same designs would put the arrival off again.
+        if (isRamping() && std::equal(std::begin(coefficients), std::end(coefficients), std::begin(rampTargets), isSameDesign))
+            return;
+
+        SampleType largestMove = 0;
+
+        for (int i = 0; i < NumStages; ++i)
+        {
+            const auto from = getPoles(current[i]);
+            const auto to = getPoles(coefficients[i]);
+
+            for (int p = 0; p < 2; ++p)
+                largestMove = juce::jmax(largestMove, std::abs(to.radius[p] - from.radius[p]),
+                                         std::abs(to.angle[p] - from.angle[p]) / juce::MathConstants<SampleType>::pi);
+        }
+
+        // Every stage arrives at the same time, so one ramp length covers them all.
+        const auto length = juce::jlimit(numSamples, juce::jmax(numSamples, maxRampSamples),
+                                         (int) std::ceil(largestMove * (SampleType) maxRampSamples));
+        const auto scale = static_cast<SampleType> (1) / (SampleType) length;
+        bool moving = false;
+
+        for (int i = 0; i < NumStages; ++i)
+        {
+            const auto& from = current[i];
+            const auto& to = coefficients[i];
+            step[i] = { (to.b0 - from.b0) * scale, (to.b1 - from.b1) * scale, (to.b2 - from.b2) * scale,
+                        (to.a1 - from.a1) * scale, (to.a2 - from.a2) * scale };
+
+            moving = moving || step[i].b0 != 0 || step[i].b1 != 0 || step[i].b2 != 0 || step[i].a1 != 0 || step[i].a2 != 0;
+            rampTargets[i] = to;
+        }
+
+        // Bands that aren't moving don't need the per-sample steps at all.
+        rampSamplesRemaining = moving ? length : 0;
+    }
+
+    /** True until the ramp started last has arrived. */
+    bool isRamping() const { return rampSamplesRemaining > 0; }
+
+    /** Moves the ramp on without filtering anything, for slices the caller skips. */
+    void skip(int numSamples)
+    {
+        advanceRamp(juce::jmin(numSamples, rampSamplesRemaining));
+    }
+
+    /** Starts fading a stage in or out. */
+    void setStageEnabled(int stage, bool shouldBeEnabled)
+    {
+        enabled[stage] = shouldBeEnabled;
+    }
+
+    bool isStageEnabled(int stage) const
+    {
+        return enabled[stage];
+    }
+
+    bool isStageActive(int stage) const
+    {
+        return enabled[stage] || mix[stage] > 0.0f;
+    }
+
+    /** True once the delay lines of the first numChannels channels have decayed
+        below the threshold, i.e. the cascade has nothing left to ring out.
+    */
+    bool isSilent(SampleType threshold, int numChannels = maxChannels) const
+    {
+        const int numGroups = juce::jmin(maxGroups, (numChannels + numLanes - 1) / numLanes);
+
+        for (int group = 0; group < numGroups; ++group)
+            for (const auto& state : states[group])
+                for (size_t lane = 0; lane < Lanes::SIMDNumElements; ++lane)
+                    if (std::abs(state.s1.get(lane)) > threshold || std::abs(state.s2.get(lane)) > threshold)
+                        return false;
+
+        return true;
+    }
+
+    void process(SampleType* const* channelData, int numChannels, int startSample, int numSamples)
+    {
+        jassert(numChannels <= maxChannels);
+
+        int active[NumStages];
+        int numActive = 0;
+        bool fading = false;
+
+        for (int i = 0; i < NumStages; ++i)
+        {
+            if (isStageActive(i))
+            {
+                active[numActive++] = i;
+                fading = fading || ! enabled[i] || mix[i] < 1.0f;
+            }
+        }
+
+        // A fade only lasts a few milliseconds, so it takes the new designs as they are.
+        if (fading)
+        {
+            snapToTargets();
+            processFading(active, numActive, channelData, numChannels, startSample, numSamples);
+            return;
+        }
+
+        // A long move can end part way through a slice.
+        const int numRamped = juce::jmin(numSamples, rampSamplesRemaining);
+
+        if (numRamped > 0)
+        {
+            processGroups(true, active, numActive, channelData, numChannels, startSample, numRamped);
+            advanceRamp(numRamped);
+        }
+
+        if (numSamples > numRamped)
+            processGroups(false, active, numActive, channelData, numChannels, startSample + numRamped, numSamples - numRamped);
+    }
+
+private:
+    using Kernel = void (BiquadCascade::*)(const int*, SampleType* const*, int, int, int, int);
+
+    static constexpr double fadeSeconds = 0.005;
+
+    bool enabled[NumStages] {};
+    float mix[NumStages] {};
+    float fadeIncrement = 1.0f;
+
+    // Where each stage's ramp has got to, and how far it moves per sample.
+    BiquadCoefficients<SampleType> current[NumStages];
+    BiquadCoefficients<SampleType> step[NumStages];
+    BiquadCoefficients<SampleType> rampTargets[NumStages];
+    int rampSamplesRemaining = 0;
+
+    static bool isSameDesign(const BiquadCoefficients<SampleType>& a, const BiquadCoefficients<SampleType>& b)
+    {
+        return a.b0 == b.b0 && a.b1 == b.b1 && a.b2 == b.b2 && a.a1 == b.a1 && a.a2 == b.a2;
+    }
+
+    /** A stage's poles in polar form: the upper pole of a complex pair twice
+        over, or the larger then the smaller of two real ones.
+    */
+    struct Poles
+    {
+        SampleType radius[2], angle[2];
+    };
+
+    static Poles getPoles(const BiquadCoefficients<SampleType>& c)
+    {
+        const auto centre = -c.a1 / 2;
+        const auto discriminant = centre * centre - c.a2;
+
+        if (discriminant < 0)
+        {
+            const auto radius = std::sqrt(c.a2);
+            const auto angle = std::atan2(std::sqrt(-discriminant), centre);
+            return { { radius, radius }, { angle, angle } };
+        }
+
+        const auto root = std::sqrt(discriminant);
+        const SampleType real[] = { centre + root, centre - root };
+        const auto pi = juce::MathConstants<SampleType>::pi;
+        return { { std::abs(real[0]), std::abs(real[1]) }, { real[0] < 0 ? pi : 0, real[1] < 0 ? pi : 0 } };
+    }
+
+    void advanceRamp(int numSamples)
+    {
+        if (numSamples <= 0)
+            return;
+
+        rampSamplesRemaining -= numSamples;
+
+        if (rampSamplesRemaining == 0)
+        {
+            snapToTargets();
+            return;
+        }
+
+        const auto n = (SampleType) numSamples;
+
+        for (int i = 0; i < NumStages; ++i)
+        {
+            auto& c = current[i];
+            const auto& d = step[i];
+            c = { c.b0 + d.b0 * n, c.b1 + d.b1 * n, c.b2 + d.b2 * n, c.a1 + d.a1 * n, c.a2 + d.a2 * n };
+        }
+    }
+
+    void processGroups(bool ramping, const int* active, int numActive, SampleType* const* channelData, int numChannels,
+                       int startSample, int numSamples)
+    {
+        const auto& table = kernels[ramping ? 1 : 0];
+
+        for (int group = 0; group * numLanes < numChannels;)
+        {
+            const auto first = group * numLanes;
+            const auto numInPass = numChannels - first;
+            const auto numRegisters = numInPass > numLanes ? 2 : 1;
+
+            (this->*table[(size_t) numRegisters - 1][(size_t) numActive])(active, channelData + first, juce::jmin(numInPass, numRegisters * numLanes),
+                                                                          group, startSample, numSamples);
+            group += numRegisters;
+        }
+    }
+
+    /** Runs Count stages over NumRegisters groups of channels starting at
+        firstGroup. channelData points at the first channel of that group.
+        While Ramping, every pass replays the same ramp from the coefficients
+        the slice started with; process() moves the ramp on afterwards.
+    */
+    template <int Count, int NumRegisters, bool Ramping>
+    void processStages(const int* active, SampleType* const* channelData, int numChannels, int firstGroup, int startSample, int numSamples)
+    {
+        if constexpr (Count > 0)
+        {
+            Lanes b0[Count], b1[Count], b2[Count], a1[Count], a2[Count];
+            Lanes db0[Ramping ? Count : 1], db1[Ramping ? Count : 1], db2[Ramping ? Count : 1],
+                  da1[Ramping ? Count : 1], da2[Ramping ? Count : 1];
+            Lanes s1[NumRegisters][Count], s2[NumRegisters][Count];
+
+            for (int k = 0; k < Count; ++k)
+            {
+                const auto& c = Ramping ? current[active[k]] : coefficients[active[k]];
+                b0[k] = Lanes::expand(c.b0);
+                b1[k] = Lanes::expand(c.b1);
+                b2[k] = Lanes::expand(c.b2);
+                a1[k] = Lanes::expand(c.a1);
+                a2[k] = Lanes::expand(c.a2);
+
+                if constexpr (Ramping)
+                {
+                    const auto& d = step[active[k]];
+                    db0[k] = Lanes::expand(d.b0);
+                    db1[k] = Lanes::expand(d.b1);
+                    db2[k] = Lanes::expand(d.b2);
+                    da1[k] = Lanes::expand(d.a1);
+                    da2[k] = Lanes::expand(d.a2);
+                }
+
+                for (int r = 0; r < NumRegisters; ++r)
+                {
+                    s1[r][k] = states[firstGroup + r][active[k]].s1;
+                    s2[r][k] = states[firstGroup + r][active[k]].s2;
+                }
+            }
+
+            alignas (Lanes::SIMDRegisterSize) SampleType frame[NumRegisters * numLanes] = {};
+
+            for (int sample = startSample; sample < startSample + numSamples; ++sample)
+            {
+                for (int channel = 0; channel < numChannels; ++channel)
+                    frame[channel] = channelData[channel][sample];
+
+                Lanes x[NumRegisters];
+
+                for (int r = 0; r < NumRegisters; ++r)
+                    x[r] = Lanes::fromRawArray(frame + r * numLanes);
+
+                unrolled([&](int k)
+                {
+                    if constexpr (Ramping)
+                    {
+                        b0[k] = b0[k] + db0[k];
+                        b1[k] = b1[k] + db1[k];
+                        b2[k] = b2[k] + db2[k];
+                        a1[k] = a1[k] + da1[k];
+                        a2[k] = a2[k] + da2[k];
+                    }
+
+                    for (int r = 0; r < NumRegisters; ++r)
+                    {
+                        const auto y = x[r] * b0[k] + s1[r][k];
+                        s1[r][k] = x[r] * b1[k] - y * a1[k] + s2[r][k];
+                        s2[r][k] = x[r] * b2[k] - y * a2[k];
+                        x[r] = y;
+                    }
+                }, std::make_integer_sequence<int, Count>());
+
+                for (int r = 0; r < NumRegisters; ++r)
+                    x[r].copyToRawArray(frame + r * numLanes);
+
+                for (int channel = 0; channel < numChannels; ++channel)
+                    channelData[channel][sample] = frame[channel];
+            }
+
+            for (int k = 0; k < Count; ++k)
+            {
+                for (int r = 0; r < NumRegisters; ++r)
+                {
+                    states[firstGroup + r][active[k]].s1 = s1[r][k];
+                    states[firstGroup + r][active[k]].s2 = s2[r][k];
+                }
+            }
+        }
+        else
+        {
+            juce::ignoreUnused(active, channelData, numChannels, firstGroup, startSample, numSamples);
+        }
+    }
+
+    /** The general path, only used for the few milliseconds a stage is fading.
+        Every group replays the same fade from the mix it started the slice with.
+    */
+    void processFading(const int* active, int numActive, SampleType* const* channelData, int numChannels, int startSample, int numSamples)
+    {
+        float mixStep[NumStages];
+        float startMix[NumStages];
+        float m[NumStages];
+
+        for (int k = 0; k < numActive; ++k)
+        {
+            mixStep[k] = enabled[active[k]] ? fadeIncrement : -fadeIncrement;
+            startMix[k] = mix[active[k]];
+        }
+
+        for (int group = 0; group * numLanes < numChannels; ++group)
+        {
+            const auto first = group * numLanes;
+            const auto numInGroup = juce::jmin(numLanes, numChannels - first);
+            alignas (Lanes::SIMDRegisterSize) SampleType frame[Lanes::SIMDNumElements] = {};
+
+            for (int k = 0; k < numActive; ++k)
+                m[k] = startMix[k];
+
+            for (int sample = startSample; sample < startSample + numSamples; ++sample)
+            {
+                for (int channel = 0; channel < numInGroup; ++channel)
+                    frame[channel] = channelData[first + channel][sample];
+
+                auto x = Lanes::fromRawArray(frame);
+
+                for (int k = 0; k < numActive; ++k)
+                {
+                    const auto stage = active[k];
+                    m[k] = juce::jlimit(0.0f, 1.0f, m[k] + mixStep[k]);
+
+                    const auto y = processBiquad(coefficients[stage], states[group][stage], x);
+                    x = x + (y - x) * (SampleType) m[k];
+                }
+
+                x.copyToRawArray(frame);
+
+                for (int channel = 0; channel < numInGroup; ++channel)
+                    channelData[first + channel][sample] = frame[channel];
+            }
+        }
+
+        // With no channels the fade still has to move on.
+        if (numChannels <= 0)
+            for (int k = 0; k < numActive; ++k)
+                m[k] = juce::jlimit(0.0f, 1.0f, startMix[k] + mixStep[k] * (float) numSamples);
+
+        for (int k = 0; k < numActive; ++k)
+            mix[active[k]] = m[k];
+
+        // A stage that has faded out restarts from silence when it comes back.
+        for (int k = 0; k < numActive; ++k)
+            if (mix[active[k]] <= 0.0f)
+                for (auto& group : states)
+                    group[active[k]].reset();
+    }
+
+    template <int NumRegisters, bool Ramping, size_t... Counts>
+    static constexpr std::array<Kernel, sizeof...(Counts)> makeKernels(std::index_sequence<Counts...>)
+    {
+        return { &BiquadCascade::processStages<(int) Counts, NumRegisters, Ramping>... };
+    }
+
+    // Indexed by whether the coefficients are ramping, then by one or two registers.
+    static constexpr std::array<std::array<std::array<Kernel, NumStages + 1>, 2>, 2> kernels {{
+        { makeKernels<1, false>(std::make_index_sequence<NumStages + 1>()),
+          makeKernels<2, false>(std::make_index_sequence<NumStages + 1>()) },
+        { makeKernels<1, true>(std::make_index_sequence<NumStages + 1>()),
+          makeKernels<2, true>(std::make_index_sequence<NumStages + 1>()) }
+    }};
+};
@@ -0,0 +1,482 @@
+/*
+  ==============================================================================
+
+    BiquadDesigner.h
+    RBJ biquad coefficient design into caller-owned storage.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <complex>
+#include "SIMDMath.h"
+
+//==============================================================================
+/** Second-order section coefficients, normalised so that a0 == 1.
+
+    Plain data so it can live inside the band structures and be rewritten on
+    the audio thread without touching the heap.
+*/
+template <typename SampleType>
+struct BiquadCoefficients
+{
+    SampleType b0 = 1, b1 = 0, b2 = 0, a1 = 0, a2 = 0;
+};
+
+//==============================================================================
+/** The same designs as the juce::dsp::IIR::Coefficients factories used by the
+    bands, but written in place instead of returning a new ref-counted object.
+*/
+namespace BiquadDesigner
+{
+    enum FilterType
+    {
+        bell = 0,
+        lowShelf,
+        highShelf,
+        lowPass,
+        highPass,
+        numFilterTypes
+    };
+
+    template <typename SampleType>
+    inline void setNormalised(BiquadCoefficients<SampleType>& c, SampleType b0, SampleType b1, SampleType b2,
+                              SampleType a0, SampleType a1, SampleType a2)
+    {
+        const auto a0inv = static_cast<SampleType> (1) / a0;
+
+        c.b0 = b0 * a0inv;
+        c.b1 = b1 * a0inv;
+        c.b2 = b2 * a0inv;
+        c.a1 = a1 * a0inv;
+        c.a2 = a2 * a0inv;
+    }
+
+    /** Keeps the design inside the range the bilinear transform can represent. */
+    template <typename SampleType>
+    inline SampleType limitFrequency(double sampleRate, SampleType frequency)
+    {
+        return juce::jlimit(static_cast<SampleType> (2), static_cast<SampleType> (sampleRate * 0.499), frequency);
+    }
+
+    /** Gain factors are linear; anything at or below zero would produce NaNs. */
+    template <typename SampleType>
+    inline SampleType limitGain(SampleType gainFactor)
+    {
+        return juce::jmax(static_cast<SampleType> (1.0e-4), gainFactor);
+    }
+
+    /** Moves the poles just inside the stability triangle, |a2| < 1 and
+        |a1| < 1 + a2, if rounding has left them on or past its edge. Designs
+        within reach of the edge only come from very low, very narrow bands,
+        which the margin of a few ulps doesn't audibly change.
+    */
+    template <typename SampleType>
+    inline void limitStability(BiquadCoefficients<SampleType>& c)
+    {
+        constexpr auto margin = std::numeric_limits<SampleType>::epsilon() * 16;
+
+        c.a2 = juce::jlimit(margin - 1, 1 - margin, c.a2);
+        const auto a1Limit = 1 + c.a2 - margin;
+        c.a1 = juce::jlimit(-a1Limit, a1Limit, c.a1);
+    }
+
+    template <typename SampleType>
+    inline void makePeakFilter(BiquadCoefficients<SampleType>& c, double sampleRate, SampleType frequency,
+                               SampleType Q, SampleType gainFactor)
+    {
+        const auto A = std::sqrt(limitGain(gainFactor));
+        const auto omega = (juce::MathConstants<SampleType>::twoPi * limitFrequency(sampleRate, frequency)) / static_cast<SampleType> (sampleRate);
+        const auto alpha = std::sin(omega) / (Q * 2);
+        const auto c2 = -2 * std::cos(omega);
+        const auto alphaTimesA = alpha * A;
+        const auto alphaOverA = alpha / A;
+
+        setNormalised<SampleType>(c, 1 + alphaTimesA, c2, 1 - alphaTimesA, 1 + alphaOverA, c2, 1 - alphaOverA);
+    }
+
+    template <typename SampleType>
+    inline void makeLowShelf(BiquadCoefficients<SampleType>& c, double sampleRate, SampleType frequency,
+                             SampleType Q, SampleType gainFactor)
+    {
+        const auto A = std::sqrt(limitGain(gainFactor));
+        const auto aminus1 = A - 1;
+        const auto aplus1 = A + 1;
+        const auto omega = (juce::MathConstants<SampleType>::twoPi * limitFrequency(sampleRate, frequency)) / static_cast<SampleType> (sampleRate);
+        const auto coso = std::cos(omega);
+        const auto beta = std::sin(omega) * std::sqrt(A) / Q;
+        const auto aminus1TimesCoso = aminus1 * coso;
+
+        setNormalised<SampleType>(c,
+                                  A * (aplus1 - aminus1TimesCoso + beta),
+                                  A * 2 * (aminus1 - aplus1 * coso),
+                                  A * (aplus1 - aminus1TimesCoso - beta),
+                                  aplus1 + aminus1TimesCoso + beta,
+                                  -2 * (aminus1 + aplus1 * coso),
+                                  aplus1 + aminus1TimesCoso - beta);
+    }
+
+    template <typename SampleType>
+    inline void makeHighShelf(BiquadCoefficients<SampleType>& c, double sampleRate, SampleType frequency,
+                              SampleType Q, SampleType gainFactor)
+    {
+        const auto A = std::sqrt(limitGain(gainFactor));
+        const auto aminus1 = A - 1;
+        const auto aplus1 = A + 1;
+        const auto omega = (juce::MathConstants<SampleType>::twoPi * limitFrequency(sampleRate, frequency)) / static_cast<SampleType> (sampleRate);
+        const auto coso = std::cos(omega);
+        const auto beta = std::sin(omega) * std::sqrt(A) / Q;
+        const auto aminus1TimesCoso = aminus1 * coso;
+
+        setNormalised<SampleType>(c,
+                                  A * (aplus1 + aminus1TimesCoso + beta),
+                                  A * -2 * (aminus1 + aplus1 * coso),
+                                  A * (aplus1 + aminus1TimesCoso - beta),
+                                  aplus1 - aminus1TimesCoso + beta,
+                                  2 * (aminus1 - aplus1 * coso),
+                                  aplus1 - aminus1TimesCoso - beta);
+    }
+
+    template <typename SampleType>
+    inline void makeLowPass(BiquadCoefficients<SampleType>& c, double sampleRate, SampleType frequency, SampleType Q)
+    {
+        const auto n = 1 / std::tan(juce::MathConstants<SampleType>::pi * limitFrequency(sampleRate, frequency) / static_cast<SampleType> (sampleRate));
+        const auto nSquared = n * n;
+        const auto invQ = 1 / Q;
+        const auto c1 = 1 / (1 + invQ * n + nSquared);
+
+        c.b0 = c1;
+        c.b1 = c1 * 2;
+        c.b2 = c1;
+        c.a1 = c1 * 2 * (1 - nSquared);
+        c.a2 = c1 * (1 - invQ * n + nSquared);
+    }
+
+    template <typename SampleType>
+    inline void makeHighPass(BiquadCoefficients<SampleType>& c, double sampleRate, SampleType frequency, SampleType Q)
+    {
+        const auto n = std::tan(juce::MathConstants<SampleType>::pi * limitFrequency(sampleRate, frequency) / static_cast<SampleType> (sampleRate));
+        const auto nSquared = n * n;
+        const auto invQ = 1 / Q;
+        const auto c1 = 1 / (1 + invQ * n + nSquared);
+
+        c.b0 = c1;
+        c.b1 = c1 * -2;
+        c.b2 = c1;
+        c.a1 = c1 * 2 * (nSquared - 1);
+        c.a2 = c1 * (1 - invQ * n + nSquared);
+    }
+
+    /** Designs one band of the given type. Never allocates, so it is safe to
+        call from processBlock.
+    */
+    template <typename SampleType>
+    inline void design(BiquadCoefficients<SampleType>& c, int type, double sampleRate, SampleType frequency,
+                       SampleType Q, SampleType gainFactor)
+    {
+        switch (type)
+        {
+        case bell:
+            makePeakFilter(c, sampleRate, frequency, Q, gainFactor);
+            break;
+        case lowShelf:
+            makeLowShelf(c, sampleRate, frequency, Q, gainFactor);
+            break;
+        case highShelf:
+            makeHighShelf(c, sampleRate, frequency, Q, gainFactor);
+            break;
+        case lowPass:
+            makeLowPass(c, sampleRate, frequency, Q);
+            break;
+        case highPass:
+            makeHighPass(c, sampleRate, frequency, Q);
+            break;
+        default:
+            c = {};
+            break;
+        }
+    }
+
+    /** The same five designs written in terms of sin(w/2) and cos(w/2), where w is
+        the normalised angular frequency. Every RBJ term can be formed from those
+        two values without losing precision at either end of the spectrum, so
+        this is all a tabulated or approximated design needs to supply.
+    */
+    template <typename SampleType>
+    inline void designFromHalfAngle(BiquadCoefficients<SampleType>& c, int type, SampleType sinHalf, SampleType cosHalf,
+                                    SampleType Q, SampleType gainFactor)
+    {
+        const auto sinSquared = sinHalf * sinHalf;
+        const auto cosSquared = cosHalf * cosHalf;
+        const auto sino = 2 * sinHalf * cosHalf;
+        // Whichever form keeps 1 - cos(w) or 1 + cos(w) accurate near the poles.
+        const auto coso = sinHalf < cosHalf ? 1 - 2 * sinSquared : 2 * cosSquared - 1;
+        const auto alpha = sino / (Q * 2);
+
+        switch (type)
+        {
+        case bell:
+        {
+            const auto A = std::sqrt(limitGain(gainFactor));
+            setNormalised<SampleType>(c, 1 + alpha * A, -2 * coso, 1 - alpha * A, 1 + alpha / A, -2 * coso, 1 - alpha / A);
+            break;
+        }
+        case lowShelf:
+        case highShelf:
+        {
+            const auto A = std::sqrt(limitGain(gainFactor));
+            const auto aminus1 = A - 1;
+            const auto aplus1 = A + 1;
+            const auto beta = sino * std::sqrt(A) / Q;
+            const auto aminus1TimesCoso = aminus1 * coso;
+
+            if (type == lowShelf)
+                setNormalised<SampleType>(c,
+                                          A * (aplus1 - aminus1TimesCoso + beta),
+                                          A * 2 * (aminus1 - aplus1 * coso),
+                                          A * (aplus1 - aminus1TimesCoso - beta),
+                                          aplus1 + aminus1TimesCoso + beta,
+                                          -2 * (aminus1 + aplus1 * coso),
+                                          aplus1 + aminus1TimesCoso - beta);
+            else
+                setNormalised<SampleType>(c,
+                                          A * (aplus1 + aminus1TimesCoso + beta),
+                                          A * -2 * (aminus1 + aplus1 * coso),
+                                          A * (aplus1 + aminus1TimesCoso - beta),
+                                          aplus1 - aminus1TimesCoso + beta,
+                                          2 * (aminus1 - aplus1 * coso),
+                                          aplus1 - aminus1TimesCoso - beta);
+            break;
+        }
+        case lowPass:
+            setNormalised<SampleType>(c, sinSquared, 2 * sinSquared, sinSquared, 1 + alpha, -2 * coso, 1 - alpha);
+            break;
+        case highPass:
+            setNormalised<SampleType>(c, cosSquared, -2 * cosSquared, cosSquared, 1 + alpha, -2 * coso, 1 - alpha);
+            break;
+        default:
+            c = {};
+            break;
+        }
+    }
+
+    /** An analogue second-order section, with s normalised to the band frequency:
+        (n2 s^2 + n1 s + n0) / (s^2 + d1 s + d0). These are the prototypes the
+        bilinear designs above are derived from.
+    */
+    struct AnaloguePrototype
+    {
+        double n0, n1, n2, d0, d1;
+
+        /** Squared magnitude at x times the band frequency. */
+        double getMagnitudeSquared(double x) const
+        {
+            const auto x2 = x * x;
+            const auto numerator = (n0 - n2 * x2) * (n0 - n2 * x2) + n1 * n1 * x2;
+            const auto denominator = (d0 - x2) * (d0 - x2) + d1 * d1 * x2;
+            return numerator / denominator;
+        }
+    };
+
+    inline AnaloguePrototype getAnaloguePrototype(int type, double Q, double gainFactor)
+    {
+        const auto A = std::sqrt(limitGain(gainFactor));
+        const auto rootA = std::sqrt(A);
+
+        switch (type)
+        {
+        case bell:      return { 1.0, A / Q, 1.0, 1.0, 1.0 / (A * Q) };
+        case lowShelf:  return { A, rootA / Q, 1.0, 1.0 / A, 1.0 / (rootA * Q) };
+        case highShelf: return { A, A * rootA / Q, A * A, A, rootA / Q };
+        case lowPass:   return { 1.0, 0.0, 0.0, 1.0, 1.0 / Q };
+        case highPass:  return { 0.0, 0.0, 1.0, 1.0, 1.0 / Q };
+        default:        return { 1.0, 0.0, 0.0, 1.0, 1.0 };
+        }
+    }
+
+    /** Matched design after Vicanek, "Matched Second Order Digital Filters".
+
+        The poles are the analogue poles mapped through z = e^(sT), so they sit
+        exactly where the analogue filter's do however close the band is to
+        Nyquist. The numerator is then solved so that the magnitude matches the
+        analogue prototype at DC, at the band frequency and at Nyquist. Unlike
+        the bilinear designs, bells and shelves keep their analogue shape at the
+        top of the spectrum instead of being squashed towards Nyquist.
+
+        Only the poles are exact, so bells and shelves are designed with
+        whichever gain puts the sharper or lower resonance in the denominator,
+        and inverted when the other gain was asked for. An RBJ bell or shelf is
+        exactly the inverse of the same band with the reciprocal gain, and the
+        fitted numerator is always minimum phase, so the inverse is stable. The
+        high pass keeps its double zero at DC and is matched at Nyquist only.
+
+        Always computed in double, since the fit subtracts nearly equal terms at
+        low frequencies.
+    */
+    template <typename SampleType>
+    inline void designMatched(BiquadCoefficients<SampleType>& c, int type, double sampleRate, SampleType frequency,
+                              SampleType Q, SampleType gainFactor)
+    {
+        const auto w0 = juce::MathConstants<double>::twoPi * (double) limitFrequency(sampleRate, frequency) / sampleRate;
+        auto gain = (double) limitGain(gainFactor);
+
+        const bool invert = ((type == bell || type == lowShelf) && gain < 1.0) || (type == highShelf && gain > 1.0);
+
+        if (invert)
+            gain = 1.0 / gain;
+
+        const auto prototype = getAnaloguePrototype(type, (double) Q, gain);
+
+        // Poles
+        double a1, a2;
+        const auto re = -0.5 * prototype.d1 * w0;
+        const auto discriminant = 0.25 * prototype.d1 * prototype.d1 - prototype.d0;
+
+        if (discriminant < 0.0)
+        {
+            a1 = -2.0 * std::exp(re) * std::cos(w0 * std::sqrt(-discriminant));
+            a2 = std::exp(2.0 * re);
+        }
+        else
+        {
+            const auto spread = w0 * std::sqrt(discriminant);
+            a1 = -(std::exp(re + spread) + std::exp(re - spread));
+            a2 = std::exp(2.0 * re);
+        }
+
+        // Squared magnitudes at DC, Nyquist and w0 are each a weighted sum of
+        // A0..A2 (denominator) and B0..B2 (numerator), so the numerator's B
+        // terms follow directly from the three analogue magnitudes.
+        const auto A0 = (1.0 + a1 + a2) * (1.0 + a1 + a2);
+        const auto A1 = (1.0 - a1 + a2) * (1.0 - a1 + a2);
+        const auto A2 = -4.0 * a2;
+
+        const auto sinHalf = std::sin(0.5 * w0);
+        const auto phi1 = sinHalf * sinHalf;
+        const auto phi0 = 1.0 - phi1;
+        const auto phi2 = 4.0 * phi0 * phi1;
+
+        const auto B0 = A0 * prototype.getMagnitudeSquared(0.0);
+        const auto B1 = A1 * prototype.getMagnitudeSquared(juce::MathConstants<double>::pi / w0);
+        const auto B2 = (prototype.getMagnitudeSquared(1.0) * (A0 * phi0 + A1 * phi1 + A2 * phi2) - B0 * phi0 - B1 * phi1) / phi2;
+
+        const auto rootB0 = std::sqrt(B0);
+        const auto rootB1 = std::sqrt(B1);
+        const auto W = 0.5 * (rootB0 + rootB1);
+
+        auto b0 = 0.5 * (W + std::sqrt(juce::jmax(0.0, W * W + B2)));
+        auto b1 = 0.5 * (rootB0 - rootB1);
+        auto b2 = b0 > 0.0 ? -B2 / (4.0 * b0) : 0.0;
+
+        if (type == highPass)
+        {
+            b0 = 0.25 * rootB1;
+            b1 = -2.0 * b0;
+            b2 = b0;
+        }
+
+        if (invert)
+        {
+            c.b0 = (SampleType) (1.0 / b0);
+            c.b1 = (SampleType) (a1 / b0);
+            c.b2 = (SampleType) (a2 / b0);
+            c.a1 = (SampleType) (b1 / b0);
+            c.a2 = (SampleType) (b2 / b0);
+        }
+        else
+        {
+            c.b0 = (SampleType) b0;
+            c.b1 = (SampleType) b1;
+            c.b2 = (SampleType) b2;
+            c.a1 = (SampleType) a1;
+            c.a2 = (SampleType) a2;
+        }
+    }
+
+    /** Fills sin(w/2) and cos(w/2) for a whole array of frequencies, given as log2
+        of Hz, one SIMD register at a time. All three arrays must be SIMD aligned
+        and numValues a multiple of the register width. Frequencies are limited
+        the same way as limitFrequency.
+    */
+    inline void computeHalfAngles(const float* log2Frequencies, float* sinHalf, float* cosHalf, int numValues, double sampleRate)
+    {
+        using FloatRegister = SIMDMath::FloatRegister;
+        constexpr int width = (int) FloatRegister::SIMDNumElements;
+
+        const auto lowest = FloatRegister::expand(1.0f);
+        const auto highest = FloatRegister::expand((float) std::log2(sampleRate * 0.499));
+        const auto radiansPerHz = (float) (juce::MathConstants<double>::pi / sampleRate);
+
+        for (int i = 0; i < numValues; i += width)
+        {
+            const auto log2Frequency = FloatRegister::min(highest, FloatRegister::max(lowest, FloatRegister::fromRawArray(log2Frequencies + i)));
+            const auto halfOmega = SIMDMath::exp2(log2Frequency) * radiansPerHz;
+
+            SIMDMath::sin(halfOmega).copyToRawArray(sinHalf + i);
+            SIMDMath::cos(halfOmega).copyToRawArray(cosHalf + i);
+        }
+    }
+
+    /** Radius of the larger pole, which sets how slowly the impulse response decays. */
+    template <typename SampleType>
+    inline double getPoleRadius(const BiquadCoefficients<SampleType>& c)
+    {
+        const auto a1 = (double) c.a1;
+        const auto a2 = (double) c.a2;
+        const auto discriminant = a1 * a1 - 4.0 * a2;
+
+        if (discriminant < 0.0)
+            return std::sqrt(a2);
+
+        return 0.5 * (std::abs(a1) + std::sqrt(discriminant));
+    }
+
+    /** Magnitude response of a set of coefficients at the given frequency. */
+    template <typename SampleType>
+    inline double getMagnitudeForFrequency(const BiquadCoefficients<SampleType>& c, double frequency, double sampleRate)
+    {
+        const auto z1 = std::polar(1.0, -juce::MathConstants<double>::twoPi * frequency / sampleRate);
+        const auto z2 = z1 * z1;
+        const auto numerator = (double) c.b0 + (double) c.b1 * z1 + (double) c.b2 * z2;
+        const auto denominator = 1.0 + (double) c.a1 * z1 + (double) c.a2 * z2;
+
+        return std::abs(numerator) / std::abs(denominator);
+    }
+
+    /** Deviation from unity below which a band counts as transparent. */
+    static constexpr double transparentDecibels = 0.01;
+
+    /** True if a band stays within transparentDecibels of unity over the audible
+        range for every setting between the given gain limits.
+
+        Bells peak at their gain, and shelves stay within their gain times a
+        factor that grows with Q. Pass filters never qualify: the frequency
+        parameters stop at 20 Hz and 20 kHz, and a corner at either end is
+        already several dB down there.
+    */
+    template <typename SampleType>
+    inline bool isTransparent(int type, SampleType Q, SampleType lowGain, SampleType highGain)
+    {
+        const auto isNearUnity = [](double gainFactor, double tolerance)
+        {
+            return std::abs(juce::Decibels::gainToDecibels(gainFactor, -200.0)) < tolerance;
+        };
+
+        switch (type)
+        {
+        case bell:
+            return isNearUnity(limitGain(lowGain), transparentDecibels)
+                && isNearUnity(limitGain(highGain), transparentDecibels);
+        case lowShelf:
+        case highShelf:
+        {
+            const auto tolerance = transparentDecibels / juce::jmax(1.0, (double) Q);
+            return isNearUnity(limitGain(lowGain), tolerance) && isNearUnity(limitGain(highGain), tolerance);
+        }
+        default:
+            return false;
+        }
+    }
+}
@@ -0,0 +1,50 @@
+/*
+  ==============================================================================
+
+    CoefficientTables.cpp
+    Tabulated coefficient design for bands that are redesigned at audio rate.
+
+  ==============================================================================
+*/
+
+#include "CoefficientTables.h"
+
+CoefficientTables::CoefficientTables(double rate)
+    : sampleRate(rate)
+{
+    // Same limits as BiquadDesigner::limitFrequency.
+    const double minLog2 = std::log2(2.0);
+    const double maxLog2 = std::log2(sampleRate * 0.499);
+
+    minLog2Frequency = (float) minLog2;
+    pointsPerOctave = (float) ((tableSize - 1) / (maxLog2 - minLog2));
+
+    entries.resize((size_t) tableSize);
+
+    for (int i = 0; i < tableSize; ++i)
+    {
+        const auto frequency = std::exp2(minLog2 + i / (double) pointsPerOctave);
+        const auto halfOmega = juce::MathConstants<double>::pi * frequency / sampleRate;
+
+        entries[(size_t) i] = { (float) std::sin(halfOmega), (float) std::cos(halfOmega) };
+    }
+}
+
+std::shared_ptr<const CoefficientTables> CoefficientTables::getForSampleRate(double sampleRate)
+{
+    static juce::CriticalSection lock;
+    static std::map<double, std::weak_ptr<const CoefficientTables>> cache;
+
+    const juce::ScopedLock sl(lock);
+
+    auto& entry = cache[sampleRate];
+    auto tables = entry.lock();
+
+    if (tables == nullptr)
+    {
+        tables = std::make_shared<const CoefficientTables>(sampleRate);
+        entry = tables;
+    }
+
+    return tables;
+}
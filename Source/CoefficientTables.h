@@ -0,0 +1,79 @@
+/*
+  ==============================================================================
+
+    CoefficientTables.h
+    Tabulated coefficient design for bands that are redesigned at audio rate.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "BiquadDesigner.h"
+
+//==============================================================================
+/** Replaces the trigonometry of BiquadDesigner with a table lookup.
+
+    All five band types only need sin(w/2) and cos(w/2), so one table per
+    sample rate covers them all. It spans 2 Hz to just under Nyquist on a log2
+    frequency axis and is read with linear interpolation. Gain and Q stay exact,
+    so a design costs two interpolated lookups, two square roots for the gain
+    types, and the algebra of BiquadDesigner::designFromHalfAngle.
+
+    Measured against a double-precision BiquadDesigner::design over
+    20 Hz - 20 kHz, Q 0.1 - 10 and gain factors 0.1 - 10 at 44.1, 48, 96 and
+    192 kHz, every coefficient is within 8e-5 (relative to the largest b for
+    the b coefficients, absolute for a). For bands above 1 kHz the response is
+    within 0.005 dB of the double-precision design at 44.1/48 kHz, 0.01 dB at
+    96 kHz and 0.03 dB at 192 kHz. Below 1 kHz float coefficient rounding
+    dominates, and the exact float design is itself several dB out at high Q
+    and high rates; the tables add at most 0.04 dB to its error at 44.1/48 kHz,
+    0.25 dB at 96 kHz and 0.5 dB at 192 kHz. Use the double-precision path
+    where that matters.
+
+    Tables are built on first use for a sample rate and shared read-only by
+    every instance running at that rate.
+*/
+class CoefficientTables
+{
+public:
+    static constexpr int tableSize = 2048;
+
+    /** Returns the shared tables for a sample rate, building them if no other
+        instance holds them. Call this from prepareToPlay, never the audio thread.
+    */
+    static std::shared_ptr<const CoefficientTables> getForSampleRate(double sampleRate);
+
+    explicit CoefficientTables(double sampleRate);
+
+    double getSampleRate() const { return sampleRate; }
+
+    /** Designs a band from the log2 of its frequency in Hz. */
+    void design(BiquadCoefficients<float>& c, int type, float log2Frequency, float Q, float gainFactor) const
+    {
+        const auto position = juce::jlimit(0.0f, (float) (tableSize - 1), (log2Frequency - minLog2Frequency) * pointsPerOctave);
+        const auto index = juce::jmin((int) position, tableSize - 2);
+        const auto fraction = position - (float) index;
+        const auto& lower = entries[(size_t) index];
+        const auto& upper = entries[(size_t) index + 1];
+
+        const auto sinHalf = lower.sinHalf + fraction * (upper.sinHalf - lower.sinHalf);
+        const auto cosHalf = lower.cosHalf + fraction * (upper.cosHalf - lower.cosHalf);
+
+        BiquadDesigner::designFromHalfAngle(c, type, sinHalf, cosHalf, Q, gainFactor);
+    }
+
+private:
+    struct Entry
+    {
+        float sinHalf, cosHalf;
+    };
+
+    double sampleRate;
+    float minLog2Frequency = 1.0f;
+    float pointsPerOctave = 1.0f;
+    std::vector<Entry> entries;
+
+    JUCE_DECLARE_NON_COPYABLE (CoefficientTables)
+};
@@ -0,0 +1,125 @@
+/*
+  ==============================================================================
+
+    DriftEngine.h
+    Triangle drift between a band's min/max limits, as a function of time.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/** Sweeps a normalised position back and forth between 0 and 1.
+
+    Speeds are in range traversals per unit of time: with time in seconds, a
+    speed of 1 goes from one limit to the other in a second and back again in
+    the next. Negative speeds run the same triangle backwards.
+
+    The phase is a closed-form function of time, anchor + speed * time / 2,
+    not a running sum, so it depends only on where in the timeline it is asked
+    for and never on how the timeline was stepped through to get there.
+    Changing the speed or setting the phase moves the anchor so that the sweep
+    carries on from where it is. Everything is in double precision because the
+    slowest speeds move the phase by less than a float ulp per tick, and hours
+    of time must not swamp it.
+*/
+class DriftLfo
+{
+public:
+    void setPosition(double normalisedPosition)
+    {
+        setPhase(0.5 * juce::jlimit(0.0, 1.0, normalisedPosition));
+    }
+
+    /** Moves to the given time, at the given speed from the current time on. */
+    void moveTo(double newTime, double traversalsPerUnit)
+    {
+        if (traversalsPerUnit != speed)
+        {
+            speed = traversalsPerUnit;
+            anchor = wrap(phase - 0.5 * speed * time);
+        }
+
+        time = newTime;
+        phase = wrap(anchor + 0.5 * speed * time);
+    }
+
+    /** Measures time from a new origin, or in new units, without moving the
+        phase.
+    */
+    void rebaseTime(double newTime)
+    {
+        time = newTime;
+        anchor = wrap(phase - 0.5 * speed * time);
+    }
+
+    /** The raw phase, for saving and restoring the sweep exactly. 0 to 0.5 runs
+        up from the start of the range, 0.5 to 1 back down.
+    */
+    double getPhase() const
+    {
+        return phase;
+    }
+
+    void setPhase(double newPhase)
+    {
+        phase = wrap(newPhase);
+        anchor = wrap(phase - 0.5 * speed * time);
+    }
+
+    /** Sets the phase the sweep had at another time, such as a phase saved
+        with the time it was saved at. The next moveTo() lands wherever the
+        sweep would have got to from there.
+    */
+    void setPhase(double newPhase, double atTime)
+    {
+        time = atTime;
+        setPhase(newPhase);
+    }
+
+    float getPosition() const
+    {
+        return static_cast<float>(phase < 0.5 ? 2.0 * phase : 2.0 - 2.0 * phase);
+    }
+
+private:
+    static double wrap(double x)
+    {
+        return x - std::floor(x);
+    }
+
+    double phase = 0.0;
+    double anchor = 0.0;
+    double speed = 0.0;
+    double time = 0.0;
+};
+
+//==============================================================================
+/** Mapping between drift positions and parameter values. Gain drifts linearly,
+    frequency drifts evenly in octaves.
+*/
+namespace DriftRange
+{
+    inline float linearValue(float start, float end, float position)
+    {
+        return start + (end - start) * position;
+    }
+
+    inline float linearPosition(float start, float end, float value)
+    {
+        return end != start ? (value - start) / (end - start) : 0.0f;
+    }
+
+    inline float logValue(float start, float end, float position)
+    {
+        return start * std::pow(end / start, position);
+    }
+
+    inline float logPosition(float start, float end, float value)
+    {
+        return end != start ? std::log(value / start) / std::log(end / start) : 0.0f;
+    }
+}
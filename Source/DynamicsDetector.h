@@ -0,0 +1,165 @@
+/*
+  ==============================================================================
+
+    DynamicsDetector.h
+    Level detection for dynamic bands, one band per SIMD lane.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "BiquadDesigner.h"
+#include "SIMDMath.h"
+
+//==============================================================================
+/** Follows the level of a mono detector signal in each band's region.
+
+    Every band has its own detector filter and envelope, but they all listen to
+    the same signal, so the bands sit side by side in the lanes of a register
+    and each sample is a handful of vector operations however many bands are
+    dynamic. Lanes past NumBands have zero coefficients and stay silent.
+
+    The envelope is a peak hold that decays at the release rate, followed by a
+    one-pole smoother at the attack rate. Neither step needs a comparison, so
+    the lanes never diverge.
+*/
+template <int NumBands>
+class DynamicsDetector
+{
+public:
+    using FloatRegister = SIMDMath::FloatRegister;
+
+    static constexpr int numLanes = (int) FloatRegister::SIMDNumElements;
+    static constexpr int numRegisters = (NumBands + numLanes - 1) / numLanes;
+    static constexpr int paddedSize = numRegisters * numLanes;
+
+    void prepare(double newSampleRate)
+    {
+        sampleRate = newSampleRate;
+        reset();
+    }
+
+    void reset()
+    {
+        std::fill(std::begin(s1), std::end(s1), 0.0f);
+        std::fill(std::begin(s2), std::end(s2), 0.0f);
+        std::fill(std::begin(peak), std::end(peak), 0.0f);
+        std::fill(std::begin(envelope), std::end(envelope), 0.0f);
+    }
+
+    /** Attack and release are the times, in milliseconds, the envelope takes to
+        get within 1/e of a step up or down.
+    */
+    void setTimes(int band, float attackMilliseconds, float releaseMilliseconds)
+    {
+        const auto samples = [this](float milliseconds)
+        {
+            return juce::jmax(1.0, (double) milliseconds * 0.001 * sampleRate);
+        };
+
+        attack[band] = (float) (1.0 - std::exp(-1.0 / samples(attackMilliseconds)));
+        release[band] = (float) std::exp(-1.0 / samples(releaseMilliseconds));
+    }
+
+    /** The detector listens where the band acts: a band-pass around a bell, and
+        a low- or high-pass below or above a shelf or pass filter. Takes the same
+        half angles as BiquadDesigner::designFromHalfAngle.
+    */
+    void setFilter(int band, int type, float sinHalf, float cosHalf, float Q)
+    {
+        BiquadCoefficients<float> c;
+
+        if (type == BiquadDesigner::bell)
+        {
+            // Constant 0 dB peak band-pass.
+            const auto sino = 2.0f * sinHalf * cosHalf;
+            const auto coso = sinHalf < cosHalf ? 1.0f - 2.0f * sinHalf * sinHalf : 2.0f * cosHalf * cosHalf - 1.0f;
+            const auto alpha = sino / (Q * 2.0f);
+            BiquadDesigner::setNormalised(c, alpha, 0.0f, -alpha, 1.0f + alpha, -2.0f * coso, 1.0f - alpha);
+        }
+        else
+        {
+            const bool low = type == BiquadDesigner::lowShelf || type == BiquadDesigner::lowPass;
+            BiquadDesigner::designFromHalfAngle(c, low ? BiquadDesigner::lowPass : BiquadDesigner::highPass,
+                                                sinHalf, cosHalf, Q, 1.0f);
+        }
+
+        b0[band] = c.b0;
+        b1[band] = c.b1;
+        b2[band] = c.b2;
+        a1[band] = c.a1;
+        a2[band] = c.a2;
+    }
+
+    /** Runs the detector over numSamples of mono input. */
+    void process(const float* input, int numSamples)
+    {
+        FloatRegister cb0[numRegisters], cb1[numRegisters], cb2[numRegisters], ca1[numRegisters], ca2[numRegisters];
+        FloatRegister att[numRegisters], rel[numRegisters];
+        FloatRegister z1[numRegisters], z2[numRegisters], held[numRegisters], env[numRegisters];
+
+        for (int r = 0; r < numRegisters; ++r)
+        {
+            const int offset = r * numLanes;
+            cb0[r] = FloatRegister::fromRawArray(b0 + offset);
+            cb1[r] = FloatRegister::fromRawArray(b1 + offset);
+            cb2[r] = FloatRegister::fromRawArray(b2 + offset);
+            ca1[r] = FloatRegister::fromRawArray(a1 + offset);
+            ca2[r] = FloatRegister::fromRawArray(a2 + offset);
+            att[r] = FloatRegister::fromRawArray(attack + offset);
+            rel[r] = FloatRegister::fromRawArray(release + offset);
+            z1[r] = FloatRegister::fromRawArray(s1 + offset);
+            z2[r] = FloatRegister::fromRawArray(s2 + offset);
+            held[r] = FloatRegister::fromRawArray(peak + offset);
+            env[r] = FloatRegister::fromRawArray(envelope + offset);
+        }
+
+        const auto zero = FloatRegister::expand(0.0f);
+
+        for (int n = 0; n < numSamples; ++n)
+        {
+            const auto x = FloatRegister::expand(input[n]);
+
+            for (int r = 0; r < numRegisters; ++r)
+            {
+                const auto y = x * cb0[r] + z1[r];
+                z1[r] = x * cb1[r] - y * ca1[r] + z2[r];
+                z2[r] = x * cb2[r] - y * ca2[r];
+
+                const auto rectified = FloatRegister::max(y, zero - y);
+                held[r] = FloatRegister::max(rectified, held[r] * rel[r]);
+                env[r] = env[r] + (held[r] - env[r]) * att[r];
+            }
+        }
+
+        for (int r = 0; r < numRegisters; ++r)
+        {
+            const int offset = r * numLanes;
+            z1[r].copyToRawArray(s1 + offset);
+            z2[r].copyToRawArray(s2 + offset);
+            held[r].copyToRawArray(peak + offset);
+            env[r].copyToRawArray(envelope + offset);
+        }
+    }
+
+    /** Current level in a band, as a linear amplitude. */
+    float getEnvelope(int band) const { return envelope[band]; }
+
+private:
+    double sampleRate = 44100.0;
+
+    alignas (64) float b0[paddedSize] {};
+    alignas (64) float b1[paddedSize] {};
+    alignas (64) float b2[paddedSize] {};
+    alignas (64) float a1[paddedSize] {};
+    alignas (64) float a2[paddedSize] {};
+    alignas (64) float attack[paddedSize] {};
+    alignas (64) float release[paddedSize] {};
+
+    alignas (64) float s1[paddedSize] {};
+    alignas (64) float s2[paddedSize] {};
+    alignas (64) float peak[paddedSize] {};
+    alignas (64) float envelope[paddedSize] {};
+};
@@ -0,0 +1,340 @@
+/*
+  ==============================================================================
+
+    EQBandBank.h
+    Control-rate state of every band, stored as one array per field.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "BiquadDesigner.h"
+#include "CoefficientTables.h"
+#include "DriftEngine.h"
+#include "DynamicsDetector.h"
+#include "SvfCascade.h"
+
+//==============================================================================
+/** Parameter mirrors and drift state for all bands.
+
+    The values every coefficient design reads sit at the top in cache-line
+    aligned arrays padded to whole SIMD registers, so the trigonometry for every
+    band runs in one vectorised pass. Drift settings follow, and the static
+    parameter values, which are only read when a parameter changes, come last.
+
+    A band drifts while its direction is non-zero and its range is not empty.
+    The direction scales the speed and its sign sets which way the sweep runs.
+    Frequencies drift in octaves, so they are kept as log2 of Hz.
+
+    A dynamic band is also turned down by a compressor-style gain computer
+    while its detector level is over the threshold, by at most
+    maxDynamicCutDecibels. Pass filters have no gain, so dynamics don't move
+    them.
+*/
+template <int NumBands>
+struct EQBandBank
+{
+    static constexpr int numLanes = (int) SIMDMath::FloatRegister::SIMDNumElements;
+    static constexpr int paddedSize = ((NumBands + numLanes - 1) / numLanes) * numLanes;
+    static constexpr juce::uint32 allBandsMask = (1u << NumBands) - 1;
+    static constexpr float maxDynamicCutDecibels = 24.0f;
+
+    EQBandBank()
+    {
+        for (auto& t : prevType)
+            t = -1;
+
+        for (int i = 0; i < paddedSize; ++i)
+        {
+            gainCurrent[i] = 1.0f;
+            freqLog2Current[i] = std::log2(1000.0f);
+            Q[i] = 1.0f;
+        }
+    }
+
+    //==============================================================================
+    alignas (64) float gainCurrent[paddedSize];
+    alignas (64) float freqLog2Current[paddedSize];
+    alignas (64) float Q[paddedSize];
+    int type[NumBands] {};
+    juce::uint32 needsUpdate = allBandsMask;
+
+    //==============================================================================
+    juce::uint32 gainDrifting = 0;
+    juce::uint32 freqDrifting = 0;
+    DriftLfo gainDrift[NumBands];
+    DriftLfo freqDrift[NumBands];
+    float gainSpeed[NumBands] {};
+    float gainDirection[NumBands] {};
+    float gainMin[NumBands] {};
+    float gainMax[NumBands] {};
+    float freqSpeed[NumBands] {};
+    float freqDirection[NumBands] {};
+    float freqLog2Min[NumBands] {};
+    float freqLog2Max[NumBands] {};
+
+    //==============================================================================
+    juce::uint32 dynamic = 0;
+    float dynamicThreshold[NumBands] {};
+    float dynamicRatio[NumBands] {};
+    float dynamicAttack[NumBands] {};
+    float dynamicRelease[NumBands] {};
+
+    //==============================================================================
+    float freqMin[NumBands] {};
+    float freqMax[NumBands] {};
+    // Hz, kept in step with freqLog2Current while the band isn't drifting.
+    float freqStatic[NumBands] {};
+    float prevGain[NumBands] {};
+    float prevFreq[NumBands] {};
+    float prevQ[NumBands] {};
+    int prevType[NumBands];
+
+    //==============================================================================
+    bool isGainDrifting(int band) const { return (gainDrifting & (1u << band)) != 0; }
+    bool isFreqDrifting(int band) const { return (freqDrifting & (1u << band)) != 0; }
+    bool isDynamic(int band) const { return (dynamic & (1u << band)) != 0; }
+
+    /** Puts every drifting band where its sweep is at the given time, in
+        seconds or beats to match how the speeds are meant. Bands that aren't
+        drifting keep their phase but follow the time, so that a sweep starts
+        from where it is set and not from wherever time was when it stopped.
+    */
+    void advanceDrift(double time)
+    {
+        for (int i = 0; i < NumBands; ++i)
+        {
+            if (isGainDrifting(i))
+            {
+                gainDrift[i].moveTo(time, gainSpeed[i] * gainDirection[i]);
+                gainCurrent[i] = DriftRange::linearValue(gainMin[i], gainMax[i], gainDrift[i].getPosition());
+            }
+            else
+            {
+                gainDrift[i].rebaseTime(time);
+            }
+
+            if (isFreqDrifting(i))
+            {
+                freqDrift[i].moveTo(time, freqSpeed[i] * freqDirection[i]);
+                freqLog2Current[i] = DriftRange::linearValue(freqLog2Min[i], freqLog2Max[i], freqDrift[i].getPosition());
+            }
+            else
+            {
+                freqDrift[i].rebaseTime(time);
+            }
+        }
+
+        needsUpdate |= gainDrifting | freqDrifting;
+    }
+
+    /** Keeps every sweep where it is while time changes units. */
+    void rebaseDrift(double time)
+    {
+        for (int i = 0; i < NumBands; ++i)
+        {
+            gainDrift[i].rebaseTime(time);
+            freqDrift[i].rebaseTime(time);
+        }
+    }
+
+    /** Points each dynamic band's detector at where the band currently sits.
+        Call after advanceDrift(), so drifting bands are followed.
+    */
+    void designDetectors(double sampleRate, DynamicsDetector<NumBands>& detector) const
+    {
+        alignas (64) float sinHalf[paddedSize];
+        alignas (64) float cosHalf[paddedSize];
+
+        BiquadDesigner::computeHalfAngles(freqLog2Current, sinHalf, cosHalf, paddedSize, sampleRate);
+
+        for (int i = 0; i < NumBands; ++i)
+            if (isDynamic(i))
+                detector.setFilter(i, type[i], sinHalf[i], cosHalf[i], Q[i]);
+    }
+
+    /** Scales each dynamic band's gain by the cut its detector level calls for.
+        The gain it scales is the drift value advanceDrift() has just written,
+        or the static parameter value, so the cut never compounds.
+    */
+    void applyDynamics(const DynamicsDetector<NumBands>& detector)
+    {
+        for (int i = 0; i < NumBands; ++i)
+        {
+            if (! isDynamic(i))
+                continue;
+
+            const auto level = juce::Decibels::gainToDecibels(detector.getEnvelope(i), -120.0f);
+            const auto over = juce::jmax(0.0f, level - dynamicThreshold[i]);
+            const auto cut = juce::jmin(maxDynamicCutDecibels, over * (1.0f - 1.0f / dynamicRatio[i]));
+            const auto gain = isGainDrifting(i) ? gainCurrent[i] : prevGain[i];
+
+            gainCurrent[i] = gain * juce::Decibels::decibelsToGain(-cut);
+        }
+
+        needsUpdate |= dynamic;
+    }
+
+    /** Checks a band over its whole drift range, so a drifting band isn't
+        switched in and out as it passes through unity.
+    */
+    bool isTransparent(int band) const
+    {
+        const auto gains = getGainRange(band);
+        return BiquadDesigner::isTransparent(type[band], Q[band], gains.getStart(), gains.getEnd());
+    }
+
+    /** How many samples the band's impulse response takes to fall by
+        decayDecibels, for the slowest-decaying setting anywhere in its drift
+        range. The poles ring longest at a corner of the range, so only the
+        corners are designed.
+    */
+    double getTailSamples(int band, double sampleRate, bool matched, double decayDecibels) const
+    {
+        const auto gains = getGainRange(band);
+        const auto frequencies = getFrequencyRange(band);
+        double radius = 0.0;
+
+        for (auto frequency : { frequencies.getStart(), frequencies.getEnd() })
+        {
+            for (auto gain : { gains.getStart(), gains.getEnd() })
+            {
+                BiquadCoefficients<double> c;
+
+                if (matched)
+                    BiquadDesigner::designMatched(c, type[band], sampleRate, (double) frequency, (double) Q[band], (double) gain);
+                else
+                    BiquadDesigner::design(c, type[band], sampleRate, (double) frequency, (double) Q[band], (double) gain);
+
+                radius = juce::jmax(radius, BiquadDesigner::getPoleRadius(c));
+            }
+        }
+
+        if (radius <= 0.0)
+            return 0.0;
+
+        jassert(radius < 1.0);
+        return std::log(juce::Decibels::decibelsToGain(-decayDecibels)) / std::log(juce::jmin(radius, 0.999999));
+    }
+
+    juce::Range<float> getGainRange(int band) const
+    {
+        juce::Range<float> gains { prevGain[band], prevGain[band] };
+
+        if (isGainDrifting(band))
+            gains = { juce::jmin(gainMin[band], gainMax[band]), juce::jmax(gainMin[band], gainMax[band]) };
+
+        // Dynamics can only cut, so they stretch the range downwards.
+        if (isDynamic(band))
+            gains.setStart(gains.getStart() * juce::Decibels::decibelsToGain(-maxDynamicCutDecibels));
+
+        return gains;
+    }
+
+    juce::Range<float> getFrequencyRange(int band) const
+    {
+        if (isFreqDrifting(band))
+            return { juce::jmin(freqMin[band], freqMax[band]), juce::jmax(freqMin[band], freqMax[band]) };
+
+        return { freqStatic[band], freqStatic[band] };
+    }
+
+    /** Redesigns every band flagged in needsUpdate. Without tables, sin(w/2) and
+        cos(w/2) for all bands come from one SIMD pass, and only the per-type
+        algebra runs band by band.
+    */
+    void designCoefficients(double sampleRate, BiquadCoefficients<float>* coefficients, const CoefficientTables* tables)
+    {
+        if (needsUpdate == 0)
+            return;
+
+        if (tables != nullptr)
+        {
+            for (int i = 0; i < NumBands; ++i)
+                if ((needsUpdate & (1u << i)) != 0)
+                    tables->design(coefficients[i], type[i], freqLog2Current[i], Q[i], gainCurrent[i]);
+        }
+        else
+        {
+            alignas (64) float sinHalf[paddedSize];
+            alignas (64) float cosHalf[paddedSize];
+
+            BiquadDesigner::computeHalfAngles(freqLog2Current, sinHalf, cosHalf, paddedSize, sampleRate);
+
+            for (int i = 0; i < NumBands; ++i)
+                if ((needsUpdate & (1u << i)) != 0)
+                    BiquadDesigner::designFromHalfAngle(coefficients[i], type[i], sinHalf[i], cosHalf[i], Q[i], gainCurrent[i]);
+        }
+
+        needsUpdate = 0;
+    }
+
+    /** The double-precision path designs every flagged band exactly, in double.
+        The tables aren't used here: their float half-angles would throw away
+        the low-frequency accuracy this path exists for.
+    */
+    void designCoefficients(double sampleRate, BiquadCoefficients<double>* coefficients)
+    {
+        for (int i = 0; i < NumBands; ++i)
+        {
+            if ((needsUpdate & (1u << i)) != 0)
+                BiquadDesigner::design(coefficients[i], type[i], sampleRate, getFrequency(i), (double) Q[i], (double) gainCurrent[i]);
+        }
+
+        needsUpdate = 0;
+    }
+
+    /** Redesigns every flagged band with BiquadDesigner::designMatched, in either
+        precision. That design needs its own exp and cos per band, so there is
+        nothing to share across bands here.
+    */
+    template <typename SampleType>
+    void designMatchedCoefficients(double sampleRate, BiquadCoefficients<SampleType>* coefficients)
+    {
+        for (int i = 0; i < NumBands; ++i)
+            if ((needsUpdate & (1u << i)) != 0)
+                BiquadDesigner::designMatched(coefficients[i], type[i], sampleRate, (SampleType) getFrequency(i),
+                                              (SampleType) Q[i], (SampleType) gainCurrent[i]);
+
+        needsUpdate = 0;
+    }
+
+    /** State-variable versions of every flagged band's design. In float, tan(w/2)
+        comes from the same SIMD half-angle pass as the biquad designs; in
+        double it is worked out exactly.
+    */
+    template <typename SampleType>
+    void designSvfCoefficients(double sampleRate, SvfCoefficients<SampleType>* coefficients)
+    {
+        if (needsUpdate == 0)
+            return;
+
+        if constexpr (std::is_same_v<SampleType, float>)
+        {
+            alignas (64) float sinHalf[paddedSize];
+            alignas (64) float cosHalf[paddedSize];
+
+            BiquadDesigner::computeHalfAngles(freqLog2Current, sinHalf, cosHalf, paddedSize, sampleRate);
+
+            for (int i = 0; i < NumBands; ++i)
+                if ((needsUpdate & (1u << i)) != 0)
+                    SvfDesigner::designFromTan(coefficients[i], type[i], sinHalf[i] / cosHalf[i], Q[i], gainCurrent[i]);
+        }
+        else
+        {
+            for (int i = 0; i < NumBands; ++i)
+                if ((needsUpdate & (1u << i)) != 0)
+                    SvfDesigner::design(coefficients[i], type[i], sampleRate, getFrequency(i), (double) Q[i], (double) gainCurrent[i]);
+        }
+
+        needsUpdate = 0;
+    }
+
+    /** Current frequency of a band in Hz. */
+    double getFrequency(int band) const
+    {
+        return isFreqDrifting(band) ? std::exp2((double) freqLog2Current[band]) : (double) freqStatic[band];
+    }
+};
@@ -0,0 +1,275 @@
+/*
+  ==============================================================================
+
+    LinearPhaseEngine.cpp
+    Linear-phase version of the band cascade, as a partitioned FFT convolution.
+
+  ==============================================================================
+*/
+
+#include "LinearPhaseEngine.h"
+
+LinearPhaseEngine::LinearPhaseEngine()
+{
+}
+
+LinearPhaseEngine::~LinearPhaseEngine()
+{
+    release();
+}
+
+int LinearPhaseEngine::getKernelSize(double sampleRate)
+{
+    return juce::jmax(2 * partitionSize, juce::nextPowerOfTwo(juce::roundToInt(sampleRate / 12.0)));
+}
+
+void LinearPhaseEngine::prepare(double newSampleRate, int newNumChannels)
+{
+    const juce::ScopedLock sl (setupLock);
+
+    // The background thread reads the sizes below, so it has to be kept out
+    // while they change.
+    detach();
+    ready.store(false);
+
+    sampleRate = newSampleRate;
+    kernelSize = getKernelSize(sampleRate);
+    numPartitions = kernelSize / partitionSize;
+    numChannels = juce::jmax(1, newNumChannels);
+
+    if (enabled)
+    {
+        allocate();
+        attach();
+    }
+    else
+    {
+        // The audio thread is stopped here, so this is the one safe place to
+        // give back what an earlier enable allocated.
+        partitionFFT.reset();
+        activeKernel = {};
+        spectra = {};
+        inputBlocks = {};
+        outputBlocks = {};
+        fftBuffer = {};
+        offlineScratch = {};
+        offlineKernel = {};
+        backgroundScratch = {};
+        fadeTarget = nullptr;
+    }
+}
+
+void LinearPhaseEngine::setEnabled(bool shouldBeEnabled)
+{
+    const juce::ScopedLock sl (setupLock);
+    enabled = shouldBeEnabled;
+
+    // Before the first prepare() there's nothing to size the buffers by.
+    if (sampleRate <= 0.0)
+        return;
+
+    if (! enabled)
+    {
+        detach();
+        return;
+    }
+
+    if (! ready.load())
+        allocate();
+
+    attach();
+}
+
+void LinearPhaseEngine::release()
+{
+    const juce::ScopedLock sl (setupLock);
+    detach();
+}
+
+void LinearPhaseEngine::allocate()
+{
+    const auto kernelBins = (size_t) (numPartitions * numBins);
+
+    partitionFFT = std::make_unique<juce::dsp::FFT>(partitionOrder + 1);
+    activeKernel.assign(kernelBins, {});
+    spectra.resize((size_t) numChannels * kernelBins);
+    inputBlocks.resize((size_t) numChannels * 2 * partitionSize);
+    outputBlocks.resize((size_t) numChannels * partitionSize);
+    fftBuffer.resize(4 * partitionSize);
+    offlineKernel.partitions.resize(kernelBins);
+
+    for (auto* scratch : { &offlineScratch, &backgroundScratch })
+    {
+        scratch->kernelFFT = std::make_unique<juce::dsp::FFT>(juce::roundToInt(std::log2(kernelSize)));
+        scratch->partitionFFT = std::make_unique<juce::dsp::FFT>(partitionOrder + 1);
+        scratch->kernelBuffer.resize((size_t) kernelSize * 2);
+        scratch->taps.resize(4 * partitionSize);
+    }
+
+    // A unit impulse at the kernel's centre: the centre is a whole number of
+    // partitions in, so that partition is flat and every other one is zero.
+    const auto centrePartition = (kernelSize / 2) / partitionSize;
+
+    for (int bin = 0; bin < numBins; ++bin)
+        activeKernel[(size_t) (centrePartition * numBins + bin)] = 1.0f;
+
+    fadeTarget = nullptr;
+    fadeBlocksRemaining = 0;
+    reset();
+
+    ready.store(true, std::memory_order_release);
+}
+
+void LinearPhaseEngine::attach()
+{
+    if (! attached)
+    {
+        thread->addTimeSliceClient(this);
+        attached = true;
+    }
+}
+
+void LinearPhaseEngine::detach()
+{
+    // Returns only once any time slice in progress has finished.
+    if (attached)
+    {
+        thread->removeTimeSliceClient(this);
+        attached = false;
+    }
+}
+
+void LinearPhaseEngine::reset()
+{
+    std::fill(spectra.begin(), spectra.end(), Complex());
+    std::fill(inputBlocks.begin(), inputBlocks.end(), 0.0f);
+    std::fill(outputBlocks.begin(), outputBlocks.end(), 0.0f);
+    position = 0;
+    head = 0;
+}
+
+//==============================================================================
+void LinearPhaseEngine::processPartition(int numChannelsToProcess)
+{
+    // A kernel designed offline has already overtaken anything the background
+    // thread was still working on, so older serials are dropped.
+    if (kernels.update() && kernels.getReadBuffer().serial > fadeSerial)
+    {
+        fadeTarget = &kernels.getReadBuffer();
+        fadeSerial = fadeTarget->serial;
+        const bool matches = fadeTarget->kernelSize == kernelSize && fadeTarget->sampleRate == sampleRate;
+        fadeBlocksRemaining = matches ? fadeBlocks : 0;
+    }
+
+    if (fadeBlocksRemaining > 0)
+    {
+        const auto& target = fadeTarget->partitions;
+        const auto amount = 1.0f / (float) fadeBlocksRemaining;
+
+        for (size_t i = 0; i < activeKernel.size(); ++i)
+            activeKernel[i] += (target[i] - activeKernel[i]) * amount;
+
+        --fadeBlocksRemaining;
+    }
+
+    head = (head + 1) % numPartitions;
+    auto* frequencyData = reinterpret_cast<Complex*>(fftBuffer.data());
+
+    for (int channel = 0; channel < numChannelsToProcess; ++channel)
+    {
+        auto* input = getInputBlock(channel);
+        auto* channelSpectra = spectra.data() + (size_t) channel * (size_t) (numPartitions * numBins);
+
+        std::copy(input, input + 2 * partitionSize, fftBuffer.begin());
+        partitionFFT->performRealOnlyForwardTransform(fftBuffer.data(), true);
+        std::copy(frequencyData, frequencyData + numBins, channelSpectra + head * numBins);
+
+        // The newest input spectrum meets the first kernel partition, the one
+        // before it the second, and so on.
+        std::fill(frequencyData, frequencyData + numBins, Complex());
+
+        for (int p = 0; p < numPartitions; ++p)
+        {
+            const auto* x = channelSpectra + ((head - p + numPartitions) % numPartitions) * numBins;
+            const auto* h = activeKernel.data() + p * numBins;
+
+            for (int bin = 0; bin < numBins; ++bin)
+                frequencyData[bin] += x[bin] * h[bin];
+        }
+
+        partitionFFT->performRealOnlyInverseTransform(fftBuffer.data());
+
+        // Overlap-save: only the second half of the circular convolution is valid.
+        std::copy(fftBuffer.begin() + partitionSize, fftBuffer.begin() + 2 * partitionSize, getOutputBlock(channel));
+        std::copy(input + partitionSize, input + 2 * partitionSize, input);
+    }
+}
+
+void LinearPhaseEngine::designKernelNow()
+{
+    // A request published before the render went offline may still be being
+    // designed in the background, so this one uses its own scratch space.
+    auto& request = requests.getWriteBuffer();
+    request.serial = ++lastSerial;
+    buildKernel(request, offlineKernel, offlineScratch);
+    fadeTarget = &offlineKernel;
+    fadeSerial = offlineKernel.serial;
+    fadeBlocksRemaining = fadeBlocks;
+}
+
+//==============================================================================
+int LinearPhaseEngine::useTimeSlice()
+{
+    if (requests.update())
+    {
+        buildKernel(requests.getReadBuffer(), kernels.getWriteBuffer(), backgroundScratch);
+        kernels.publish();
+    }
+
+    return 10;
+}
+
+void LinearPhaseEngine::buildKernel(const KernelRequest& request, Kernel& kernel, DesignScratch& scratch) const
+{
+    auto& kernelBuffer = scratch.kernelBuffer;
+    kernel.serial = request.serial;
+    kernel.sampleRate = sampleRate;
+    kernel.kernelSize = kernelSize;
+    kernel.partitions.resize((size_t) (numPartitions * numBins));
+
+    // Zero-phase spectrum: the cascade's magnitude at every bin.
+    std::fill(kernelBuffer.begin(), kernelBuffer.end(), 0.0f);
+
+    for (int bin = 0; bin <= kernelSize / 2; ++bin)
+    {
+        const auto frequency = bin * sampleRate / kernelSize;
+        double magnitude = 1.0;
+
+        for (int stage = 0; stage < juce::jmin(request.numStages, maxStages); ++stage)
+            magnitude *= BiquadDesigner::getMagnitudeForFrequency(request.coefficients[stage], frequency, sampleRate);
+
+        kernelBuffer[(size_t) bin * 2] = (float) magnitude;
+    }
+
+    scratch.kernelFFT->performRealOnlyInverseTransform(kernelBuffer.data());
+
+    // Rotate the impulse from sample 0 to the centre and window it there.
+    auto& taps = scratch.taps;
+
+    for (int p = 0; p < numPartitions; ++p)
+    {
+        std::fill(taps.begin(), taps.end(), 0.0f);
+
+        for (int i = 0; i < partitionSize; ++i)
+        {
+            const auto n = p * partitionSize + i;
+            const auto window = 0.5 - 0.5 * std::cos(juce::MathConstants<double>::twoPi * n / kernelSize);
+            taps[(size_t) i] = kernelBuffer[(size_t) ((n + kernelSize / 2) % kernelSize)] * (float) window;
+        }
+
+        scratch.partitionFFT->performRealOnlyForwardTransform(taps.data(), true);
+
+        const auto* spectrum = reinterpret_cast<const Complex*>(taps.data());
+        std::copy(spectrum, spectrum + numBins, kernel.partitions.begin() + p * numBins);
+    }
+}
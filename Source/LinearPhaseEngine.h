@@ -0,0 +1,209 @@
+/*
+  ==============================================================================
+
+    LinearPhaseEngine.h
+    Linear-phase version of the band cascade, as a partitioned FFT convolution.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <complex>
+#include "BackgroundThread.h"
+#include "BiquadDesigner.h"
+#include "TripleBuffer.h"
+
+//==============================================================================
+/** Runs the magnitude response of a set of biquads with zero phase, delayed by
+    half the kernel.
+
+    The audio thread hands over the current coefficients whenever they change.
+    The SharedBackgroundThread samples the cascade's magnitude at every bin of
+    a kernelSize FFT, turns that into a Hann-windowed symmetric FIR, and
+    transforms it in partitionSize pieces. The finished partitions come back
+    through a TripleBuffer, so the audio thread never waits for a design.
+
+    Filtering is uniformly partitioned overlap-save: every partitionSize input
+    samples, each channel takes one FFT, multiplies it against every kernel
+    partition in a frequency-domain delay line, and takes one inverse FFT.
+    A new kernel is faded in by moving the partitions in use towards it over
+    fadeBlocks partitions. Interpolating the spectra of two linear-phase
+    kernels with the same delay interpolates their responses, so drift moves
+    the curve smoothly and never needs two convolutions at once.
+
+    Latency is half the kernel plus one partition.
+
+    Nothing is allocated and the background thread isn't polled until the
+    engine is enabled, so an instance that never uses linear phase only pays
+    for the object itself. Disabling it detaches from the thread but keeps the
+    buffers, since the audio thread may still be finishing a block with them;
+    they go at the next prepare() that finds the engine disabled.
+*/
+class LinearPhaseEngine  : private juce::TimeSliceClient
+{
+public:
+    static constexpr int maxStages = 8;
+    static constexpr int partitionOrder = 8;
+    static constexpr int partitionSize = 1 << partitionOrder;
+    static constexpr int fadeBlocks = 8;
+
+    /** The enabled stages of the cascade. */
+    struct KernelRequest
+    {
+        int serial = 0;
+        int numStages = 0;
+        BiquadCoefficients<double> coefficients[maxStages];
+    };
+
+    LinearPhaseEngine();
+    ~LinearPhaseEngine() override;
+
+    /** Sets the sample rate and channel count. If the engine is enabled this
+        allocates everything and starts with a kernel that only delays;
+        otherwise it frees whatever an earlier enable left behind. Call from
+        prepareToPlay.
+    */
+    void prepare(double sampleRate, int numChannels);
+
+    /** Message thread: allocates and attaches to the background thread on the
+        first enable after prepare(), and detaches when disabled. The audio
+        thread sees the change through isReady().
+    */
+    void setEnabled(bool shouldBeEnabled);
+
+    /** Detaches from the background thread. Call from releaseResources. */
+    void release();
+
+    /** Audio thread: true once the buffers exist. Nothing below may be called
+        until it is.
+    */
+    bool isReady() const { return ready.load(std::memory_order_acquire); }
+
+    int getLatencySamples() const { return kernelSize / 2 + partitionSize; }
+
+    /** Kernel length in samples, which grows with the sample rate so that the
+        frequency resolution stays at about 12 Hz.
+    */
+    static int getKernelSize(double sampleRate);
+
+    //==============================================================================
+    /** Audio thread: clears the signal history, keeping the kernel. */
+    void reset();
+
+    /** Audio thread: fill in the request and call requestKernel(). */
+    KernelRequest& getKernelRequest() { return requests.getWriteBuffer(); }
+    void requestKernel()
+    {
+        requests.getWriteBuffer().serial = ++lastSerial;
+        requests.publish();
+    }
+
+    /** Audio thread, non-realtime only: designs the kernel for the filled-in
+        request right here instead of on the background thread, so that an
+        offline render doesn't depend on the background thread's timing.
+    */
+    void designKernelNow();
+
+    template <typename SampleType>
+    void process(SampleType* const* channelData, int numChannelsToProcess, int startSample, int numSamples)
+    {
+        numChannelsToProcess = juce::jmin(numChannelsToProcess, numChannels);
+
+        for (int done = 0; done < numSamples;)
+        {
+            const int chunk = juce::jmin(numSamples - done, partitionSize - position);
+
+            for (int channel = 0; channel < numChannelsToProcess; ++channel)
+            {
+                auto* input = getInputBlock(channel) + partitionSize + position;
+                const auto* output = getOutputBlock(channel) + position;
+                auto* data = channelData[channel] + startSample + done;
+
+                for (int i = 0; i < chunk; ++i)
+                {
+                    input[i] = (float) data[i];
+                    data[i] = (SampleType) output[i];
+                }
+            }
+
+            position += chunk;
+            done += chunk;
+
+            if (position == partitionSize)
+            {
+                processPartition(numChannelsToProcess);
+                position = 0;
+            }
+        }
+    }
+
+private:
+    using Complex = std::complex<float>;
+    static constexpr int numBins = partitionSize + 1;
+
+    struct Kernel
+    {
+        int serial = 0;
+        double sampleRate = 0.0;
+        int kernelSize = 0;
+        std::vector<Complex> partitions;
+    };
+
+    /** Working space for one kernel design. The background thread and an
+        offline designKernelNow() each have their own, since a design queued
+        just before a render went offline can still be running.
+    */
+    struct DesignScratch
+    {
+        std::unique_ptr<juce::dsp::FFT> kernelFFT, partitionFFT;
+        std::vector<float> kernelBuffer, taps;
+    };
+
+    int useTimeSlice() override;
+    void allocate();
+    void attach();
+    void detach();
+    void buildKernel(const KernelRequest& request, Kernel& kernel, DesignScratch& scratch) const;
+    void processPartition(int numChannelsToProcess);
+
+    float* getInputBlock(int channel) { return inputBlocks.data() + (size_t) channel * 2 * partitionSize; }
+    float* getOutputBlock(int channel) { return outputBlocks.data() + (size_t) channel * partitionSize; }
+
+    juce::SharedResourcePointer<SharedBackgroundThread> thread;
+
+    // Only changed under setupLock, which the audio thread never takes.
+    juce::CriticalSection setupLock;
+    bool enabled = false;
+    bool attached = false;
+    std::atomic<bool> ready { false };
+
+    // Fixed between prepare() calls.
+    double sampleRate = 0.0;
+    int kernelSize = 0;
+    int numPartitions = 0;
+    int numChannels = 0;
+
+    // Audio thread only.
+    std::unique_ptr<juce::dsp::FFT> partitionFFT;
+    std::vector<Complex> activeKernel;
+    std::vector<Complex> spectra;
+    std::vector<float> inputBlocks, outputBlocks, fftBuffer;
+    DesignScratch offlineScratch;
+    Kernel offlineKernel;
+    const Kernel* fadeTarget = nullptr;
+    int fadeSerial = 0;
+    int lastSerial = 0;
+    int fadeBlocksRemaining = 0;
+    int position = 0;
+    int head = 0;
+
+    // Background thread only.
+    DesignScratch backgroundScratch;
+
+    TripleBuffer<KernelRequest> requests;
+    TripleBuffer<Kernel> kernels;
+
+    JUCE_DECLARE_NON_COPYABLE (LinearPhaseEngine)
+};
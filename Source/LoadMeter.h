@@ -0,0 +1,183 @@
+/*
+  ==============================================================================
+
+    LoadMeter.h
+    Lock-free timing of processBlock against the buffer deadline.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/** Measures how much of each block's real-time budget the processor uses.
+
+    The audio thread brackets a block with beginBlock() and endBlock(), and
+    calls lap() at the end of each stage of work, which charges the time since
+    the previous lap to that stage. A lap is one read of the high resolution
+    clock, so a slice costs one read per stage. endBlock() reads the clock once
+    more and charges whatever came after the last lap to other, so the load
+    always covers the whole block.
+
+    Everything the message thread reads is an atomic written by the audio thread
+    alone, so neither side ever waits and nothing is allocated. Loads are
+    fractions of the block's deadline, numSamples / sampleRate: 1 means the
+    block took as long to process as it lasts.
+*/
+class ProcessLoadMeter
+{
+public:
+    enum Stage
+    {
+        parameterUpdate = 0,
+        coefficientDesign,
+        filtering,
+        other,
+        numStages
+    };
+
+    /** Blocks are counted in 5% steps of the deadline, and the last bin holds
+        every block that overran it.
+    */
+    static constexpr int numHistogramBins = 21;
+    static constexpr float histogramBinWidth = 0.05f;
+
+    struct Statistics
+    {
+        float averageLoad = 0.0f;
+        float worstLoad = 0.0f;
+        float stageLoad[numStages] {};
+        juce::uint32 histogram[numHistogramBins] {};
+        juce::uint64 numBlocks = 0;
+    };
+
+    //==============================================================================
+    /** Call before processing starts, not concurrently with the audio thread. */
+    void prepare(double newSampleRate)
+    {
+        sampleRate = newSampleRate;
+        ticksPerSecond = (double) juce::Time::getHighResolutionTicksPerSecond();
+        smoothedBlockSize = 0;
+        clear();
+    }
+
+    /** Asks the audio thread to zero everything at the start of its next block.
+        Safe to call from any thread.
+    */
+    void requestReset()
+    {
+        resetRequested.store(true, std::memory_order_relaxed);
+    }
+
+    //==============================================================================
+    void beginBlock()
+    {
+        if (resetRequested.exchange(false, std::memory_order_relaxed))
+            clear();
+
+        blockStart = juce::Time::getHighResolutionTicks();
+        lastLap = blockStart;
+
+        for (auto& ticks : stageTicks)
+            ticks = 0;
+    }
+
+    void lap(Stage stage)
+    {
+        const auto now = juce::Time::getHighResolutionTicks();
+        stageTicks[stage] += now - lastLap;
+        lastLap = now;
+    }
+
+    void endBlock(int numSamples)
+    {
+        if (numSamples <= 0 || sampleRate <= 0.0)
+            return;
+
+        // The averages fall to 1/e of an old value over averagingSeconds of audio.
+        if (numSamples != smoothedBlockSize)
+        {
+            smoothedBlockSize = numSamples;
+            smoothing = (float) (1.0 - std::exp(-numSamples / (sampleRate * averagingSeconds)));
+        }
+
+        lap(other);
+
+        const auto deadlineTicks = numSamples * ticksPerSecond / sampleRate;
+        const auto load = (float) ((lastLap - blockStart) / deadlineTicks);
+
+        const auto smooth = [this](std::atomic<float>& average, float value)
+        {
+            const auto previous = average.load(std::memory_order_relaxed);
+            average.store(previous + smoothing * (value - previous), std::memory_order_relaxed);
+        };
+
+        smooth(averageLoad, load);
+
+        for (int stage = 0; stage < numStages; ++stage)
+            smooth(stageLoad[stage], (float) (stageTicks[stage] / deadlineTicks));
+
+        if (load > worstLoad.load(std::memory_order_relaxed))
+            worstLoad.store(load, std::memory_order_relaxed);
+
+        auto& bin = histogram[juce::jlimit(0, numHistogramBins - 1, (int) (load / histogramBinWidth))];
+        bin.store(bin.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        numBlocks.store(numBlocks.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    //==============================================================================
+    /** A copy of the current figures. The fields are read one by one, so they may
+        straddle a block, but each of them is always a value the audio thread
+        actually wrote.
+    */
+    Statistics getStatistics() const
+    {
+        Statistics s;
+        s.averageLoad = averageLoad.load(std::memory_order_relaxed);
+        s.worstLoad = worstLoad.load(std::memory_order_relaxed);
+        s.numBlocks = numBlocks.load(std::memory_order_relaxed);
+
+        for (int stage = 0; stage < numStages; ++stage)
+            s.stageLoad[stage] = stageLoad[stage].load(std::memory_order_relaxed);
+
+        for (int i = 0; i < numHistogramBins; ++i)
+            s.histogram[i] = histogram[i].load(std::memory_order_relaxed);
+
+        return s;
+    }
+
+private:
+    static constexpr double averagingSeconds = 0.5;
+
+    void clear()
+    {
+        averageLoad.store(0.0f, std::memory_order_relaxed);
+        worstLoad.store(0.0f, std::memory_order_relaxed);
+        numBlocks.store(0, std::memory_order_relaxed);
+
+        for (auto& load : stageLoad)
+            load.store(0.0f, std::memory_order_relaxed);
+
+        for (auto& bin : histogram)
+            bin.store(0, std::memory_order_relaxed);
+    }
+
+    // Audio thread only.
+    double sampleRate = 0.0;
+    double ticksPerSecond = 1.0;
+    juce::int64 blockStart = 0;
+    juce::int64 lastLap = 0;
+    juce::int64 stageTicks[numStages] {};
+    int smoothedBlockSize = 0;
+    float smoothing = 1.0f;
+
+    // Written by the audio thread, read anywhere.
+    std::atomic<float> averageLoad { 0.0f };
+    std::atomic<float> worstLoad { 0.0f };
+    std::atomic<float> stageLoad[numStages] {};
+    std::atomic<juce::uint32> histogram[numHistogramBins] {};
+    std::atomic<juce::uint64> numBlocks { 0 };
+    std::atomic<bool> resetRequested { false };
+};
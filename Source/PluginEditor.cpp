@@ -9,14 +9,178 @@
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
 
+//==============================================================================
+LoadMeterDisplay::LoadMeterDisplay (EchidnaAudioProcessor& p)
+    : audioProcessor (p)
+{
+    resetButton.onClick = [this] { audioProcessor.resetLoadStatistics(); };
+    addAndMakeVisible (resetButton);
+    startTimerHz (10);
+}
+
+void LoadMeterDisplay::timerCallback()
+{
+    statistics = audioProcessor.getLoadStatistics();
+    repaint();
+}
+
+void LoadMeterDisplay::paint (juce::Graphics& g)
+{
+    const auto percent = [](float load) { return juce::String (load * 100.0f, 1) + "%"; };
+
+    auto area = getLocalBounds().reduced (6);
+    area.removeFromRight (resetButton.getWidth() + 6);
+
+    g.setColour (juce::Colours::white);
+    g.setFont (13.0f);
+    g.drawText ("DSP " + percent (statistics.averageLoad)
+                  + "  (params " + percent (statistics.stageLoad[ProcessLoadMeter::parameterUpdate])
+                  + ", design " + percent (statistics.stageLoad[ProcessLoadMeter::coefficientDesign])
+                  + ", filter " + percent (statistics.stageLoad[ProcessLoadMeter::filtering])
+                  + ", other " + percent (statistics.stageLoad[ProcessLoadMeter::other])
+                  + ")  worst " + percent (statistics.worstLoad),
+                area.removeFromTop (18), juce::Justification::centredLeft);
+
+    // One bar per 5% of the deadline, scaled to the fullest bin. The last bin
+    // counts overruns, so it is drawn in red.
+    const auto histogramArea = area.reduced (0, 4).toFloat();
+    const auto barWidth = histogramArea.getWidth() / (float) ProcessLoadMeter::numHistogramBins;
+    juce::uint32 fullest = 1;
+
+    for (auto count : statistics.histogram)
+        fullest = juce::jmax (fullest, count);
+
+    for (int i = 0; i < ProcessLoadMeter::numHistogramBins; ++i)
+    {
+        const auto height = histogramArea.getHeight() * (float) statistics.histogram[i] / (float) fullest;
+
+        g.setColour (i == ProcessLoadMeter::numHistogramBins - 1 ? juce::Colours::red : juce::Colours::lightgreen);
+        g.fillRect (histogramArea.getX() + (float) i * barWidth, histogramArea.getBottom() - height,
+                    juce::jmax (1.0f, barWidth - 1.0f), height);
+    }
+}
+
+void LoadMeterDisplay::resized()
+{
+    resetButton.setBounds (getLocalBounds().reduced (6).removeFromRight (60).removeFromTop (24));
+}
+
+//==============================================================================
+SpectrumDisplay::SpectrumDisplay (SpectrumAnalyser& a)
+    : analyser (a)
+{
+    setActive (true);
+}
+
+SpectrumDisplay::~SpectrumDisplay()
+{
+    analyser.setEnabled (false);
+}
+
+void SpectrumDisplay::setActive (bool shouldBeActive)
+{
+    analyser.setEnabled (shouldBeActive);
+
+    if (shouldBeActive)
+    {
+        startTimerHz (30);
+    }
+    else
+    {
+        stopTimer();
+        inputPath.clear();
+        outputPath.clear();
+        repaint();
+    }
+}
+
+void SpectrumDisplay::timerCallback()
+{
+    if (analyser.updateSpectrum())
+    {
+        rebuildPaths();
+        repaint();
+    }
+}
+
+void SpectrumDisplay::resized()
+{
+    if (isTimerRunning())
+        rebuildPaths();
+}
+
+void SpectrumDisplay::rebuildPaths()
+{
+    const auto& spectrum = analyser.getSpectrum();
+    const auto width = (float) getWidth();
+    const auto height = (float) getHeight();
+
+    // 0 dBFS at the top, the analyser's floor at the bottom.
+    const auto toY = [height](float decibels)
+    {
+        return juce::jmap (decibels, 0.0f, SpectrumAnalyser::floorDecibels, 0.0f, height);
+    };
+
+    inputPath.clear();
+    outputPath.clear();
+    inputPath.startNewSubPath (0.0f, height);
+
+    for (int i = 0; i < SpectrumAnalyser::numPoints; ++i)
+    {
+        const auto x = width * (float) i / (float) (SpectrumAnalyser::numPoints - 1);
+        inputPath.lineTo (x, toY (spectrum.input[i]));
+
+        if (i == 0)
+            outputPath.startNewSubPath (x, toY (spectrum.output[i]));
+        else
+            outputPath.lineTo (x, toY (spectrum.output[i]));
+    }
+
+    inputPath.lineTo (width, height);
+    inputPath.closeSubPath();
+}
+
+void SpectrumDisplay::paint (juce::Graphics& g)
+{
+    g.fillAll (juce::Colours::black);
+
+    g.setColour (juce::Colours::grey.withAlpha (0.4f));
+    g.fillPath (inputPath);
+
+    g.setColour (juce::Colours::cyan.withAlpha (0.7f));
+    g.strokePath (outputPath, juce::PathStrokeType (1.0f));
+}
+
 //==============================================================================
 EchidnaAudioProcessorEditor::EchidnaAudioProcessorEditor (EchidnaAudioProcessor& p)
-    : AudioProcessorEditor (&p), audioProcessor (p)
+    : AudioProcessorEditor (&p), audioProcessor (p), spectrumDisplay (p.getAnalyser()), responseCurve (p),
+      parameterEditor (p), loadMeterDisplay (p)
 {
+    addAndMakeVisible (spectrumDisplay);
+    addAndMakeVisible (responseCurve);
+    addAndMakeVisible (parameterEditor);
+    addAndMakeVisible (loadMeterDisplay);
+
+    for (int slot = 0; slot < EchidnaAudioProcessor::numSnapshotSlots; ++slot)
+    {
+        const auto name = juce::String::charToString ((juce::juce_wchar) ('A' + slot));
+
+        storeButtons[slot].setButtonText ("Store " + name);
+        storeButtons[slot].onClick = [this, slot] { audioProcessor.storeSnapshot (slot); };
+        addAndMakeVisible (storeButtons[slot]);
+
+        recallButtons[slot].setButtonText ("Recall " + name);
+        recallButtons[slot].onClick = [this, slot] { audioProcessor.recallSnapshot (slot); };
+        addAndMakeVisible (recallButtons[slot]);
+    }
+
+    analyserButton.setToggleState (true, juce::dontSendNotification);
+    analyserButton.onClick = [this] { spectrumDisplay.setActive (analyserButton.getToggleState()); };
+    addAndMakeVisible (analyserButton);
+
     // Make sure that before the constructor has finished, you've set the
     // editor's size to whatever you need it to be.
-    setSize (400, 300);
-
+    setSize (juce::jmax (400, parameterEditor.getWidth()), responseCurveHeight + parameterEditor.getHeight() + snapshotBarHeight + loadMeterHeight);
 }
 
 EchidnaAudioProcessorEditor::~EchidnaAudioProcessorEditor()
@@ -29,14 +193,24 @@ void EchidnaAudioProcessorEditor::paint (juce::Graphics& g)
 {
     // (Our component is opaque, so we must completely fill the background with a solid colour)
     g.fillAll (getLookAndFeel().findColour (juce::ResizableWindow::backgroundColourId));
-
-    g.setColour (juce::Colours::white);
-    g.setFont (15.0f);
-    g.drawFittedText ("Hello World!", getLocalBounds(), juce::Justification::centred, 1);
 }
 
 void EchidnaAudioProcessorEditor::resized()
 {
-    // This is generally where you'll want to lay out the positions of any
-    // subcomponents in your editor..
+    auto area = getLocalBounds();
+    responseCurve.setBounds (area.removeFromTop (responseCurveHeight));
+    spectrumDisplay.setBounds (responseCurve.getBounds());
+    loadMeterDisplay.setBounds (area.removeFromBottom (loadMeterHeight));
+
+    auto snapshotBar = area.removeFromBottom (snapshotBarHeight).reduced (6, 4);
+    analyserButton.setBounds (snapshotBar.removeFromRight (90));
+    const auto buttonWidth = snapshotBar.getWidth() / (2 * EchidnaAudioProcessor::numSnapshotSlots);
+
+    for (int slot = 0; slot < EchidnaAudioProcessor::numSnapshotSlots; ++slot)
+    {
+        storeButtons[slot].setBounds (snapshotBar.removeFromLeft (buttonWidth).reduced (2, 0));
+        recallButtons[slot].setBounds (snapshotBar.removeFromLeft (buttonWidth).reduced (2, 0));
+    }
+
+    parameterEditor.setBounds (area);
 }
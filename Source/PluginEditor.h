@@ -10,6 +10,56 @@
 
 #include <JuceHeader.h>
 #include "PluginProcessor.h"
+#include "ResponseCurve.h"
+
+//==============================================================================
+/** Shows the processor's share of the callback budget: the smoothed load of
+    each stage, the worst block so far, and a histogram of every block's load.
+    Polls the processor from a timer, so the audio thread never knows it exists.
+*/
+class LoadMeterDisplay  : public juce::Component, private juce::Timer
+{
+public:
+    explicit LoadMeterDisplay (EchidnaAudioProcessor&);
+
+    void paint (juce::Graphics&) override;
+    void resized() override;
+
+private:
+    void timerCallback() override;
+
+    EchidnaAudioProcessor& audioProcessor;
+    ProcessLoadMeter::Statistics statistics;
+    juce::TextButton resetButton { "Reset" };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LoadMeterDisplay)
+};
+
+//==============================================================================
+/** The analyser's input spectrum as a filled area and its output spectrum as a
+    line, on the same axes as ResponseCurve so the two can be stacked. Keeps
+    the analyser running for as long as the display exists and is switched on.
+*/
+class SpectrumDisplay  : public juce::Component, private juce::Timer
+{
+public:
+    explicit SpectrumDisplay (SpectrumAnalyser&);
+    ~SpectrumDisplay() override;
+
+    void setActive (bool shouldBeActive);
+
+    void paint (juce::Graphics&) override;
+    void resized() override;
+
+private:
+    void timerCallback() override;
+    void rebuildPaths();
+
+    SpectrumAnalyser& analyser;
+    juce::Path inputPath, outputPath;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SpectrumDisplay)
+};
 
 //==============================================================================
 /**
@@ -29,5 +79,17 @@ private:
     // access the processor object that created it.
     EchidnaAudioProcessor& audioProcessor;
 
+    SpectrumDisplay spectrumDisplay;
+    ResponseCurve responseCurve;
+    juce::GenericAudioProcessorEditor parameterEditor;
+    LoadMeterDisplay loadMeterDisplay;
+    juce::TextButton storeButtons[EchidnaAudioProcessor::numSnapshotSlots];
+    juce::TextButton recallButtons[EchidnaAudioProcessor::numSnapshotSlots];
+    juce::ToggleButton analyserButton { "Analyser" };
+
+    static constexpr int responseCurveHeight = 200;
+    static constexpr int loadMeterHeight = 72;
+    static constexpr int snapshotBarHeight = 32;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (EchidnaAudioProcessorEditor)
 };
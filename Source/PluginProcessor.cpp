@@ -9,9 +9,9 @@
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
 
-const std::array<EQBandParameters, 5> EchidnaAudioProcessor::bandParamNames = [] {
-    std::array<EQBandParameters, 5> names;
-    for (int i = 0; i < 5; ++i)
+const std::array<EQBandParameters, EchidnaAudioProcessor::numBands> EchidnaAudioProcessor::bandParamNames = [] {
+    std::array<EQBandParameters, numBands> names;
+    for (int i = 0; i < numBands; ++i)
     {
         names[i] = {
             "BAND" + juce::String(i + 1) + "_GAIN",
@@ -25,12 +25,55 @@ const std::array<EQBandParameters, 5> EchidnaAudioProcessor::bandParamNames = []
             "BAND" + juce::String(i + 1) + "_FREQ_MAX",
             "BAND" + juce::String(i + 1) + "_FREQ_DIRECTION",
             "BAND" + juce::String(i + 1) + "_Q",
-            "BAND" + juce::String(i + 1) + "_TYPE"
+            "BAND" + juce::String(i + 1) + "_TYPE",
+            "BAND" + juce::String(i + 1) + "_DYNAMIC",
+            "BAND" + juce::String(i + 1) + "_THRESHOLD",
+            "BAND" + juce::String(i + 1) + "_RATIO",
+            "BAND" + juce::String(i + 1) + "_ATTACK",
+            "BAND" + juce::String(i + 1) + "_RELEASE"
         };
     }
     return names;
 }();
 
+namespace
+{
+    /** How each band parameter is created, in the order the host sees them
+        within a band. The dynamics parameters come after every global one;
+        see createParameterLayout.
+    */
+    struct BandParameterSpec
+    {
+        EQBandParameterIndex index;
+        const char* name;
+        float minimum, maximum, skew, defaultValue;
+        enum Kind { continuous, choice, toggle } kind = continuous;
+    };
+
+    constexpr BandParameterSpec bandParameterSpecs[] =
+    {
+        { gainCurrentIndex,   "Gain",       -10.0f,   10.0f,    1.0f, 0.1f },
+        { freqCurrentIndex,   "Frequency",   20.0f,   20000.0f, 1.0f, 1000.0f },
+        { QIndex,             "Q",           0.1f,    10.0f,    1.0f, 1.0f },
+        { typeIndex,          "Type",        0.0f,    4.0f,     1.0f, 0.0f, BandParameterSpec::choice },
+        { gainMinIndex,       "Gain Min",    0.0f,    2.0f,     1.0f, 0.1f },
+        { gainMaxIndex,       "Gain Max",    0.0f,    2.0f,     1.0f, 0.1f },
+        { gainSpeedIndex,     "Gain Speed",  0.001f,  3.0f,     1.0f, 0.01f },
+        { freqMinIndex,       "Freq Min",    20.0f,   2000.0f,  1.0f, 200.0f },
+        { freqMaxIndex,       "Freq Max",    20.0f,   2000.0f,  1.0f, 200.0f },
+        { freqSpeedIndex,     "Freq Speed",  0.0001f, 1.0f,     1.0f, 0.001f },
+        { gainDirectionIndex, "Gain Dir",   -1.0f,    1.0f,     1.0f, 0.0f },
+        { freqDirectionIndex, "Freq Dir",   -1.0f,    1.0f,     1.0f, 0.0f },
+        { dynamicIndex,       "Dynamic",     0.0f,    1.0f,     1.0f, 0.0f, BandParameterSpec::toggle },
+        { thresholdIndex,     "Threshold",  -60.0f,   0.0f,     1.0f, -20.0f },
+        { ratioIndex,         "Ratio",       1.0f,    20.0f,    0.3f, 2.0f },
+        { attackIndex,        "Attack",      0.1f,    200.0f,   0.3f, 10.0f },
+        { releaseIndex,       "Release",     5.0f,    2000.0f,  0.3f, 100.0f }
+    };
+
+    static_assert(std::size(bandParameterSpecs) == numEQBandParameters, "every band parameter needs a spec");
+}
+
 //==============================================================================
 EchidnaAudioProcessor::EchidnaAudioProcessor()
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -38,6 +81,7 @@ EchidnaAudioProcessor::EchidnaAudioProcessor()
                      #if ! JucePlugin_IsMidiEffect
                       #if ! JucePlugin_IsSynth
                        .withInput  ("Input",  juce::AudioChannelSet::stereo(), true)
+                       .withInput  ("Sidechain", juce::AudioChannelSet::stereo(), false)
                       #endif
                        .withOutput ("Output", juce::AudioChannelSet::stereo(), true)
                      #endif
@@ -46,11 +90,60 @@ EchidnaAudioProcessor::EchidnaAudioProcessor()
 
 #endif
 {
-    
+    controlIntervalHandle = parameters.getRawParameterValue("CONTROL_INTERVAL");
+    tableDesignHandle = parameters.getRawParameterValue("TABLE_DESIGN");
+    filterDesignHandle = parameters.getRawParameterValue("FILTER_DESIGN");
+    morphEnabledHandle = parameters.getRawParameterValue("MORPH_ENABLED");
+    morphHandle = parameters.getRawParameterValue("MORPH");
+    linearPhaseHandle = parameters.getRawParameterValue("LINEAR_PHASE");
+    sidechainHandle = parameters.getRawParameterValue("SIDECHAIN");
+    driftSyncHandle = parameters.getRawParameterValue("DRIFT_SYNC");
+    topologyHandle = parameters.getRawParameterValue("FILTER_TOPOLOGY");
+    bandsForParameterIndex.assign((size_t) getParameters().size(), 0);
+
+    for (int band = 0; band < numBands; ++band)
+    {
+        for (int index = 0; index < numEQBandParameters; ++index)
+        {
+            const auto& paramID = bandParamNames[band].get(index);
+            auto* parameter = parameters.getParameter(paramID);
+
+            parameterHandles[(size_t) (band * numEQBandParameters + index)] = parameters.getRawParameterValue(paramID);
+            bandsForParameterIndex[(size_t) parameter->getParameterIndex()] = 1u << band;
+            parameter->addListener(this);
+        }
+    }
+
+    // Moving the morph changes every band at once.
+    for (auto* paramID : { "MORPH_ENABLED", "MORPH" })
+    {
+        auto* parameter = parameters.getParameter(paramID);
+        bandsForParameterIndex[(size_t) parameter->getParameterIndex()] = allBandsMask;
+        parameter->addListener(this);
+    }
+
+    auto* linearPhaseParameter = parameters.getParameter("LINEAR_PHASE");
+    linearPhaseParameterIndex = linearPhaseParameter->getParameterIndex();
+    linearPhaseParameter->addListener(this);
+
+    // Both slots start out as the default settings.
+    for (auto& slot : messageState.slots)
+        slot = captureParameters();
+
+    pushStateMessage();
 }
 
 EchidnaAudioProcessor::~EchidnaAudioProcessor()
 {
+    for (auto& names : bandParamNames)
+        for (int index = 0; index < numEQBandParameters; ++index)
+            parameters.getParameter(names.get(index))->removeListener(this);
+
+    for (auto* paramID : { "MORPH_ENABLED", "MORPH" })
+        parameters.getParameter(paramID)->removeListener(this);
+
+    parameters.getParameter("LINEAR_PHASE")->removeListener(this);
+    cancelPendingUpdate();
 }
 
 //==============================================================================
@@ -88,7 +181,11 @@ bool EchidnaAudioProcessor::isMidiEffect() const
 
 double EchidnaAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    // A linear-phase kernel rings for its second half, after the latency.
+    if (linearPhaseReported.load() && getSampleRate() > 0.0)
+        return LinearPhaseEngine::getKernelSize(getSampleRate()) / (2.0 * getSampleRate());
+
+    return tailSeconds.load();
 }
 
 int EchidnaAudioProcessor::getNumPrograms()
@@ -119,15 +216,31 @@ void EchidnaAudioProcessor::changeProgramName (int index, const juce::String& ne
 void EchidnaAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
     
-    for (int i = 0; i < 5; ++i)
-    {
-       bands[i].filter.reset();
-    }
-    
+    floatCascade.prepare(sampleRate);
+    doubleCascade.prepare(sampleRate);
+    floatSvf.prepare();
+    doubleSvf.prepare();
+    svfNeedsSnap = true;
+    biquadNeedsSnap = true;
+    coefficientTables = CoefficientTables::getForSampleRate(sampleRate);
+    loadMeter.prepare(sampleRate);
+    analyser.prepare(sampleRate);
+    detector.prepare(sampleRate);
+    linearPhase.prepare(sampleRate, juce::jmax(getMainBusNumInputChannels(), getMainBusNumOutputChannels()));
+    linearPhase.setEnabled(linearPhaseHandle->load() >= 0.5f);
+    linearPhaseActive = false;
+    updateLatency();
+
+    // Coefficients depend on the sample rate, so everything needs redesigning.
+    bands.needsUpdate = allBandsMask;
+    dirtyBands.store(allBandsMask);
+    samplesUntilControlTick = 0;
+    nextBlockSample = 0;
 }
 
 void EchidnaAudioProcessor::releaseResources()
 {
+    linearPhase.release();
 }
 
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -137,14 +250,21 @@ bool EchidnaAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts)
     juce::ignoreUnused (layouts);
     return true;
   #else
-    if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::mono()
-     && layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
+    // Any layout the cascade has delay lines for, from mono up to 7.1.4 and
+    // third-order ambisonics.
+    const auto numChannels = layouts.getMainOutputChannelSet().size();
+
+    if (layouts.getMainOutputChannelSet().isDisabled() || numChannels > BiquadCascade<float, numBands>::maxChannels)
         return false;
 
     // This checks if the input layout matches the output layout
    #if ! JucePlugin_IsSynth
     if (layouts.getMainOutputChannelSet() != layouts.getMainInputChannelSet())
         return false;
+
+    // The sidechain is only ever summed to mono, so anything up to stereo will do.
+    if (layouts.inputBuses.size() > 1 && layouts.getChannelSet(true, 1).size() > 2)
+        return false;
    #endif
 
     return true;
@@ -154,26 +274,486 @@ bool EchidnaAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts)
 
 void EchidnaAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
-    for (int i = 0; i < 5; ++i)
+    processSamples(buffer, floatCascade, floatSvf);
+}
+
+void EchidnaAudioProcessor::processBlock(juce::AudioBuffer<double>& buffer, juce::MidiBuffer& midiMessages)
+{
+    processSamples(buffer, doubleCascade, doubleSvf);
+}
+
+bool EchidnaAudioProcessor::supportsDoublePrecisionProcessing() const
+{
+    return true;
+}
+
+template <typename SampleType>
+void EchidnaAudioProcessor::processSamples(juce::AudioBuffer<SampleType>& buffer, BiquadCascade<SampleType, numBands>& cascade,
+                                           SvfCascade<SampleType, numBands>& svf)
+{
+    juce::ScopedNoDenormals noDenormals;
+    loadMeter.beginBlock();
+    updateTimeline();
+
+    const int numChannels = juce::jmin(getMainBusNumInputChannels(), buffer.getNumChannels());
+    const int numSamples = buffer.getNumSamples();
+    auto* const* channelData = buffer.getArrayOfWritePointers();
+
+    auto* const* detectorChannels = channelData;
+    int numDetectorChannels = numChannels;
+
+    if (sidechainHandle->load(std::memory_order_relaxed) >= 0.5f && getBusCount(true) > 1)
     {
-        UpdateBandParameters(i);
+        const auto numSidechainChannels = getChannelCountOfBus(true, 1);
+        const auto firstSidechainChannel = getChannelIndexInProcessBlockBuffer(true, 1, 0);
+
+        if (numSidechainChannels > 0 && firstSidechainChannel + numSidechainChannels <= buffer.getNumChannels())
+        {
+            detectorChannels = channelData + firstSidechainChannel;
+            numDetectorChannels = numSidechainChannels;
+        }
     }
 
-    const int totalNumInputChannels = getTotalNumInputChannels();
-    const int numSamples = buffer.getNumSamples();
+    const bool analysing = analyser.pushInput(channelData, numChannels, numSamples);
+
+    // The engine is allocated and its latency reported on the message thread
+    // after the switch is thrown, so the biquads carry on until both are done.
+    const bool linearPhaseRequested = linearPhaseReported.load(std::memory_order_acquire) && linearPhase.isReady();
+
+    // Each path starts from silence when it takes over from the other.
+    if (linearPhaseRequested != linearPhaseActive)
+    {
+        linearPhaseActive = linearPhaseRequested;
+
+        if (linearPhaseActive)
+        {
+            linearPhase.reset();
+            kernelChanged = true;
+        }
+        else
+        {
+            cascade.reset();
+            biquadNeedsSnap = true;
+        }
+    }
+
+    // Linear phase is built from the biquads, so it always takes them.
+    const bool svfRequested = topologyHandle->load(std::memory_order_relaxed) >= 0.5f && ! linearPhaseActive;
+
+    if (svfRequested != useSvf)
+    {
+        useSvf = svfRequested;
+        bands.needsUpdate = allBandsMask;
+
+        if (useSvf)
+        {
+            svf.reset();
+            svfNeedsSnap = true;
+        }
+        else
+        {
+            cascade.reset();
+            biquadNeedsSnap = true;
+        }
+    }
+
+    const int intervalIndex = static_cast<int>(controlIntervalHandle->load(std::memory_order_relaxed));
+    const int requestedInterval = controlIntervals[(size_t) juce::jlimit(0, (int) controlIntervals.size() - 1, intervalIndex)];
+    loadMeter.lap(ProcessLoadMeter::other);
+
+    for (int start = 0; start < numSamples;)
+    {
+        if (samplesUntilControlTick == 0)
+        {
+            controlInterval = requestedInterval;
+
+            // A tick that lands off the grid, after a jump or a change of
+            // interval, takes its values from the grid point before it.
+            const auto tickSample = blockStartSample + start;
+            const auto gridOffset = (int) (((tickSample % controlInterval) + controlInterval) % controlInterval);
+
+            samplesUntilControlTick = controlInterval - gridOffset;
+            runControlTick(cascade, svf, tickSample - gridOffset, samplesUntilControlTick);
+        }
+
+        const int sliceLength = juce::jmin(numSamples - start, samplesUntilControlTick);
+
+        // The detector hears the input before the bands change it.
+        if (bands.dynamic != 0 && numDetectorChannels > 0)
+        {
+            const auto scale = 1.0f / (float) numDetectorChannels;
+
+            for (int n = 0; n < sliceLength; ++n)
+            {
+                SampleType sum = 0;
 
-    for (int channel = 0; channel < totalNumInputChannels; ++channel)
+                for (int channel = 0; channel < numDetectorChannels; ++channel)
+                    sum += detectorChannels[channel][start + n];
+
+                detectorInput[n] = (float) sum * scale;
+            }
+
+            detector.process(detectorInput, sliceLength);
+        }
+
+        if (linearPhaseActive)
+        {
+            linearPhase.process(channelData, numChannels, start, sliceLength);
+        }
+        else if (useSvf)
+        {
+            bool inputIsSilent = svf.isSilent((SampleType) silenceThreshold, numChannels);
+
+            for (int channel = 0; channel < numChannels && inputIsSilent; ++channel)
+                inputIsSilent = buffer.getMagnitude(channel, start, sliceLength) <= (SampleType) silenceThreshold;
+
+            // Nothing is ringing in a skipped slice, so the ramp can land on
+            // its targets early without a click.
+            if (inputIsSilent)
+            {
+                svf.reset();
+                svf.snapToTargets();
+            }
+            else
+                svf.process(channelData, numChannels, start, sliceLength);
+        }
+        else
+        {
+            bool inputIsSilent = cascade.isSilent((SampleType) silenceThreshold, numChannels);
+
+            for (int channel = 0; channel < numChannels && inputIsSilent; ++channel)
+                inputIsSilent = buffer.getMagnitude(channel, start, sliceLength) <= (SampleType) silenceThreshold;
+
+            // Once the bands have rung out, silence in is silence out. Skipping the
+            // cascade also stops its delay lines decaying into denormals. Its
+            // coefficient ramp still moves on, so the next sound starts from
+            // where the bands are now rather than from an old design.
+            if (inputIsSilent)
+            {
+                cascade.reset();
+                cascade.skip(sliceLength);
+            }
+            else
+            {
+                // Channels go through the cascade a register's worth at a time, one per SIMD lane.
+                cascade.process(channelData, numChannels, start, sliceLength);
+            }
+        }
+
+        loadMeter.lap(ProcessLoadMeter::filtering);
+
+        start += sliceLength;
+        samplesUntilControlTick -= sliceLength;
+    }
+
+    if (analysing)
+        analyser.pushOutput(channelData, numChannels);
+
+    // The kernel follows the coefficients at most once per block.
+    if (linearPhaseActive && kernelChanged)
+    {
+        requestLinearPhaseKernel(cascade);
+        kernelChanged = false;
+    }
+
+    auto& drift = publishedDrift.getWriteBuffer();
+    drift.time = lastDriftTime;
+
+    for (int i = 0; i < numBands; ++i)
     {
-        float* channelData = buffer.getWritePointer(channel);
+        drift.gain[i] = bands.gainDrift[i].getPhase();
+        drift.freq[i] = bands.freqDrift[i].getPhase();
+    }
+
+    publishedDrift.publish();
+
+    if (numResponseListeners.load(std::memory_order_relaxed) > 0
+        && (responseChanged || responseRefreshRequested.exchange(false)))
+    {
+        publishResponse(cascade);
+        responseChanged = false;
+    }
+
+    nextBlockSample = blockStartSample + numSamples;
+    loadMeter.endBlock(numSamples);
+}
+
+void EchidnaAudioProcessor::updateTimeline()
+{
+    auto position = nextBlockSample;
+    juce::Optional<double> ppq;
 
-        for (int sample = 0; sample < numSamples; ++sample)
+    if (auto* playHead = getPlayHead())
+    {
+        if (const auto info = playHead->getPosition())
         {
-            for (int i = 0; i < 5; ++i)
+            if (const auto bpm = info->getBpm(); bpm.hasValue() && *bpm > 0.0)
+                lastBpm = *bpm;
+
+            if (info->getIsPlaying())
             {
-                channelData[sample] = bands[i].filter.processSample(channelData[sample]);
+                if (const auto timeInSamples = info->getTimeInSamples())
+                    position = *timeInSamples;
+
+                ppq = info->getPpqPosition();
             }
         }
     }
+
+    // The transport moved, so the drift jumps to wherever it is at the new
+    // position and the control grid is picked up from there.
+    if (position != nextBlockSample)
+        samplesUntilControlTick = 0;
+
+    blockStartSample = position;
+    beatsPerSample = lastBpm / (60.0 * getSampleRate());
+    blockStartBeats = ppq.hasValue() ? *ppq : (double) position * beatsPerSample;
+}
+
+template <typename SampleType>
+void EchidnaAudioProcessor::publishResponse(BiquadCascade<SampleType, numBands>& cascade)
+{
+    // The SVFs have the same responses as the biquads, which are only worked
+    // out here while the SVFs are filtering.
+    if (biquadStale != 0)
+    {
+        bands.needsUpdate = biquadStale;
+        designBiquads(cascade);
+        biquadStale = 0;
+    }
+
+    auto& response = publishedResponse.getWriteBuffer();
+    response.sampleRate = getSampleRate();
+
+    for (int i = 0; i < numBands; ++i)
+    {
+        const auto& c = cascade.coefficients[i];
+        response.coefficients[i] = { (double) c.b0, (double) c.b1, (double) c.b2, (double) c.a1, (double) c.a2 };
+        response.enabled[i] = cascade.isStageEnabled(i);
+        response.frequency[i] = bands.getFrequency(i);
+    }
+
+    publishedResponse.publish();
+}
+
+template <typename SampleType>
+void EchidnaAudioProcessor::requestLinearPhaseKernel(const BiquadCascade<SampleType, numBands>& cascade)
+{
+    auto& request = linearPhase.getKernelRequest();
+    request.numStages = 0;
+
+    for (int i = 0; i < numBands; ++i)
+    {
+        if (cascade.isStageEnabled(i))
+        {
+            const auto& c = cascade.coefficients[i];
+            request.coefficients[request.numStages++] = { (double) c.b0, (double) c.b1, (double) c.b2, (double) c.a1, (double) c.a2 };
+        }
+    }
+
+    if (isNonRealtime())
+        linearPhase.designKernelNow();
+    else
+        linearPhase.requestKernel();
+}
+
+void EchidnaAudioProcessor::updateLatency()
+{
+    const bool reported = linearPhaseHandle->load() >= 0.5f && linearPhase.isReady();
+
+    // Switching off stops the audio thread using the engine before the host
+    // hears the latency has gone; switching on waits until it has arrived.
+    if (! reported)
+        linearPhaseReported.store(false, std::memory_order_release);
+
+    setLatencySamples(reported ? linearPhase.getLatencySamples() : 0);
+    linearPhaseReported.store(reported, std::memory_order_release);
+}
+
+void EchidnaAudioProcessor::updateLinearPhase()
+{
+    linearPhase.setEnabled(linearPhaseHandle->load() >= 0.5f);
+    updateLatency();
+}
+
+void EchidnaAudioProcessor::handleAsyncUpdate()
+{
+    updateLinearPhase();
+}
+
+void EchidnaAudioProcessor::addResponseListener()
+{
+    ++numResponseListeners;
+    responseRefreshRequested.store(true);
+}
+
+void EchidnaAudioProcessor::removeResponseListener()
+{
+    --numResponseListeners;
+}
+
+template <typename SampleType>
+void EchidnaAudioProcessor::runControlTick(BiquadCascade<SampleType, numBands>& cascade, SvfCascade<SampleType, numBands>& svf,
+                                           juce::int64 tickSample, int numSamplesInTick)
+{
+    auto dirty = dirtyBands.exchange(0);
+    const double sampleRate = getSampleRate();
+
+    const bool syncRequested = driftSyncHandle->load(std::memory_order_relaxed) >= 0.5f;
+    const double driftTime = syncRequested ? blockStartBeats + (double) (tickSample - blockStartSample) * beatsPerSample
+                                           : (double) tickSample / sampleRate;
+
+    // Switching between seconds and beats mustn't make the sweeps jump.
+    if (syncRequested != driftSynced)
+    {
+        driftSynced = syncRequested;
+        bands.rebaseDrift(driftTime);
+    }
+
+    // New A/B slots only matter while morphing, and then to every band.
+    if (stateMessages.update() && morphing)
+        dirty = allBandsMask;
+
+    morphing = morphEnabledHandle->load(std::memory_order_relaxed) >= 0.5f;
+    morphPosition = morphHandle->load(std::memory_order_relaxed);
+
+    // A band that has never been updated has nothing to glide from.
+    if (glideRequested.exchange(false) && bands.prevType[0] >= 0)
+    {
+        glideFrom = captureBands();
+        glideLength = juce::jmax(1, juce::roundToInt(sampleRate * glideSeconds));
+        glideSamplesRemaining = glideLength;
+        glidePosition = 0.0f;
+    }
+
+    if (glidePosition < 1.0f)
+    {
+        glideSamplesRemaining = juce::jmax(0, glideSamplesRemaining - numSamplesInTick);
+        glidePosition = 1.0f - (float) glideSamplesRemaining / (float) glideLength;
+        dirty = allBandsMask;
+    }
+
+    if (driftRestoreRequested.exchange(false))
+    {
+        stateMessages.update();
+        const auto& restored = stateMessages.getReadBuffer();
+
+        // Anchored at the time they were saved, the sweeps land where they
+        // would have been at this point of the timeline, not where the
+        // session happened to stop.
+        const auto savedTime = restored.hasDriftTime ? restored.driftTime : driftTime;
+
+        for (int i = 0; i < numBands; ++i)
+        {
+            bands.gainDrift[i].setPhase(restored.gainDriftPhase[i], savedTime);
+            bands.freqDrift[i].setPhase(restored.freqDriftPhase[i], savedTime);
+        }
+
+        restoredDrift = allBandsMask;
+        dirty = allBandsMask;
+    }
+
+    const bool tableDesignRequested = tableDesignHandle->load(std::memory_order_relaxed) >= 0.5f;
+    // The SVFs only have the bilinear designs, so the curve drawn for them and
+    // the tail reported while they filter have to come from those too.
+    const bool matchedDesignRequested = filterDesignHandle->load(std::memory_order_relaxed) >= 0.5f && ! useSvf;
+
+    const bool designChanged = tableDesignRequested != useTableDesign || matchedDesignRequested != useMatchedDesign;
+
+    if (designChanged)
+    {
+        useTableDesign = tableDesignRequested;
+        useMatchedDesign = matchedDesignRequested;
+        bands.needsUpdate = allBandsMask;
+    }
+
+    for (int i = 0; i < numBands; ++i)
+    {
+        if ((dirty & (1u << i)) != 0)
+        {
+            UpdateBandParameters(i);
+
+            const bool enabled = ! bands.isTransparent(i);
+            cascade.setStageEnabled(i, enabled);
+            svf.setStageEnabled(i, enabled);
+        }
+    }
+
+    // Restored phases are protected until the recalled parameters have all
+    // arrived, which the end of the glide allows plenty of time for.
+    if (glidePosition >= 1.0f)
+        restoredDrift = 0;
+
+    if (dirty != 0 || designChanged)
+    {
+        // The bands are in series, so their tails add up.
+        double tailSamples = 0.0;
+
+        for (int i = 0; i < numBands; ++i)
+            if (cascade.isStageEnabled(i))
+                tailSamples += bands.getTailSamples(i, sampleRate, useMatchedDesign, tailDecibels);
+
+        tailSeconds.store(tailSamples / sampleRate);
+    }
+
+    loadMeter.lap(ProcessLoadMeter::parameterUpdate);
+
+    bands.advanceDrift(driftTime);
+    lastDriftTime = driftTime;
+
+    if (bands.dynamic != 0)
+    {
+        bands.designDetectors(sampleRate, detector);
+        bands.applyDynamics(detector);
+    }
+
+    if (dirty != 0 || bands.needsUpdate != 0)
+    {
+        responseChanged = true;
+        kernelChanged = true;
+    }
+
+    if (useSvf)
+    {
+        biquadStale |= bands.needsUpdate;
+        bands.designSvfCoefficients(sampleRate, svf.targets);
+
+        // Each tick's designs are reached by the next tick.
+        if (svfNeedsSnap)
+            svf.snapToTargets();
+        else
+            svf.startRamp(numSamplesInTick);
+
+        svfNeedsSnap = false;
+    }
+    else
+    {
+        designBiquads(cascade);
+
+        // The same for the biquads, unless linear phase has taken over from them.
+        if (biquadNeedsSnap || linearPhaseActive)
+            cascade.snapToTargets();
+        else
+            cascade.startRamp(numSamplesInTick);
+
+        biquadNeedsSnap = false;
+    }
+
+    loadMeter.lap(ProcessLoadMeter::coefficientDesign);
+}
+
+template <typename SampleType>
+void EchidnaAudioProcessor::designBiquads(BiquadCascade<SampleType, numBands>& cascade)
+{
+    const double sampleRate = getSampleRate();
+
+    // Table design only speeds up the bilinear designs, so matched wins if both are on.
+    if (useMatchedDesign)
+        bands.designMatchedCoefficients(sampleRate, cascade.coefficients);
+    else if constexpr (std::is_same_v<SampleType, double>)
+        bands.designCoefficients(sampleRate, cascade.coefficients);
+    else
+        bands.designCoefficients(sampleRate, cascade.coefficients, useTableDesign ? coefficientTables.get() : nullptr);
 }
 
 //==============================================================================
@@ -184,70 +764,283 @@ bool EchidnaAudioProcessor::hasEditor() const
 
 juce::AudioProcessorEditor* EchidnaAudioProcessor::createEditor()
 {
-    return new juce::GenericAudioProcessorEditor(*this);
+    return new EchidnaAudioProcessorEditor(*this);
 }
 
 //==============================================================================
+/*  The state is a little-endian binary block:
+
+        int32   stateMagic
+        int32   stateVersion
+        int32   number of bands, then number of parameters per band
+        double  drift time the phases below were at, in seconds or beats
+                (from version 2)
+        double  gain and freq drift phase of each band
+        float   every band parameter of each A/B snapshot slot
+        the parameter tree, as written by juce::ValueTree::writeToStream
+
+    The counts let a build with a different band layout read what it can.
+*/
 void EchidnaAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
 {
-    // You should use this method to store your parameters in the memory block.
-    // You could do that either as raw data, or use the XML or ValueTree classes
-    // as intermediaries to make it easy to save and load complex data.
+    const juce::ScopedLock sl(stateLock);
+
+    publishedDrift.update();
+    const auto& drift = publishedDrift.getReadBuffer();
+
+    juce::MemoryOutputStream stream(destData, false);
+    stream.writeInt(stateMagic);
+    stream.writeInt(stateVersion);
+    stream.writeInt(numBands);
+    stream.writeInt(numEQBandParameters);
+    stream.writeDouble(drift.time);
+
+    for (int i = 0; i < numBands; ++i)
+    {
+        stream.writeDouble(drift.gain[i]);
+        stream.writeDouble(drift.freq[i]);
+    }
+
+    for (const auto& slot : messageState.slots)
+        for (int band = 0; band < numBands; ++band)
+            for (int index = 0; index < numEQBandParameters; ++index)
+                stream.writeFloat(slot.get(band, index));
+
+    parameters.copyState().writeToStream(stream);
 }
 
 void EchidnaAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
-    // You should use this method to restore your parameters from this memory block,
-    // whose contents will have been created by the getStateInformation() call.
+    juce::MemoryInputStream stream(data, (size_t) juce::jmax(0, sizeInBytes), false);
+
+    if (stream.readInt() != stateMagic)
+        return;
+
+    const auto version = stream.readInt();
+    const auto storedBands = stream.readInt();
+    const auto storedParameters = stream.readInt();
+
+    if (version < 1 || version > stateVersion || ! juce::isPositiveAndBelow(storedBands, 256)
+        || ! juce::isPositiveAndBelow(storedParameters, 256))
+        return;
+
+    const juce::ScopedLock sl(stateLock);
+    auto restored = messageState;
+    restored.hasDriftTime = version >= 2;
+    restored.driftTime = restored.hasDriftTime ? stream.readDouble() : 0.0;
+
+    for (int band = 0; band < storedBands; ++band)
+    {
+        const auto gainPhase = stream.readDouble();
+        const auto freqPhase = stream.readDouble();
+
+        if (band < numBands)
+        {
+            restored.gainDriftPhase[band] = gainPhase;
+            restored.freqDriftPhase[band] = freqPhase;
+        }
+    }
+
+    for (auto& slot : restored.slots)
+    {
+        for (int band = 0; band < storedBands; ++band)
+        {
+            for (int index = 0; index < storedParameters; ++index)
+            {
+                const auto value = stream.readFloat();
+
+                if (band < numBands && index < numEQBandParameters)
+                    slot.values[band][index] = value;
+            }
+        }
+    }
+
+    const auto tree = juce::ValueTree::readFromStream(stream);
+
+    if (! tree.hasType(parameters.state.getType()))
+        return;
+
+    // The audio thread picks up the phases and starts gliding before any of
+    // the new parameter values can reach it.
+    messageState = restored;
+    pushStateMessage();
+    driftRestoreRequested.store(true);
+    glideRequested.store(true);
+
+    parameters.replaceState(tree);
+}
+
+void EchidnaAudioProcessor::storeSnapshot(int slot)
+{
+    jassert(juce::isPositiveAndBelow(slot, numSnapshotSlots));
+
+    const juce::ScopedLock sl(stateLock);
+    messageState.slots[slot] = captureParameters();
+    pushStateMessage();
+}
+
+void EchidnaAudioProcessor::recallSnapshot(int slot)
+{
+    jassert(juce::isPositiveAndBelow(slot, numSnapshotSlots));
+
+    const juce::ScopedLock sl(stateLock);
+    const auto snapshot = messageState.slots[slot];
+    glideRequested.store(true);
+
+    for (int band = 0; band < numBands; ++band)
+    {
+        for (int index = 0; index < numEQBandParameters; ++index)
+        {
+            auto* parameter = parameters.getParameter(bandParamNames[(size_t) band].get(index));
+            parameter->setValueNotifyingHost(parameter->convertTo0to1(snapshot.get(band, index)));
+        }
+    }
+}
+
+EchidnaAudioProcessor::Snapshot EchidnaAudioProcessor::captureParameters() const
+{
+    Snapshot snapshot;
+
+    for (int band = 0; band < numBands; ++band)
+        for (int index = 0; index < numEQBandParameters; ++index)
+            snapshot.values[band][index] = parameterHandles[(size_t) (band * numEQBandParameters + index)]->load();
+
+    return snapshot;
+}
+
+/** The values the bands are actually running with, which is where a glide
+    has to start from. Audio thread only.
+*/
+EchidnaAudioProcessor::Snapshot EchidnaAudioProcessor::captureBands() const
+{
+    Snapshot snapshot;
+
+    for (int i = 0; i < numBands; ++i)
+    {
+        auto* values = snapshot.values[i];
+        values[gainCurrentIndex] = bands.prevGain[i];
+        values[gainSpeedIndex] = bands.gainSpeed[i];
+        values[gainMinIndex] = bands.gainMin[i];
+        values[gainMaxIndex] = bands.gainMax[i];
+        values[gainDirectionIndex] = bands.gainDirection[i];
+        values[freqCurrentIndex] = bands.prevFreq[i];
+        values[freqSpeedIndex] = bands.freqSpeed[i];
+        values[freqMinIndex] = bands.freqMin[i];
+        values[freqMaxIndex] = bands.freqMax[i];
+        values[freqDirectionIndex] = bands.freqDirection[i];
+        values[QIndex] = bands.prevQ[i];
+        values[typeIndex] = (float) bands.prevType[i];
+        values[dynamicIndex] = bands.isDynamic(i) ? 1.0f : 0.0f;
+        values[thresholdIndex] = bands.dynamicThreshold[i];
+        values[ratioIndex] = bands.dynamicRatio[i];
+        values[attackIndex] = bands.dynamicAttack[i];
+        values[releaseIndex] = bands.dynamicRelease[i];
+    }
+
+    return snapshot;
+}
+
+/** Hands the message-side state to the audio thread. Call with stateLock held. */
+void EchidnaAudioProcessor::pushStateMessage()
+{
+    stateMessages.getWriteBuffer() = messageState;
+    stateMessages.publish();
 }
 
 void EchidnaAudioProcessor::UpdateBandParameters(int bandIndex)
 {
+    auto& b = bands;
+    const int i = bandIndex;
+    const auto bit = 1u << i;
+
     // Fetch the current parameter values
-    float currentGain = *parameters.getRawParameterValue(bandParamNames[bandIndex].gainCurrent);
-    float currentFreq = *parameters.getRawParameterValue(bandParamNames[bandIndex].freqCurrent);
-    float currentQ = *parameters.getRawParameterValue(bandParamNames[bandIndex].Q);
-    int currentType = static_cast<int>(*parameters.getRawParameterValue(bandParamNames[bandIndex].type));
-    bool coefficientsChanged = false;
+    float currentGain = getBandParameter(bandIndex, gainCurrentIndex);
+    float currentFreq = getBandParameter(bandIndex, freqCurrentIndex);
+    float currentQ = getBandParameter(bandIndex, QIndex);
+    int currentType = static_cast<int>(getBandParameter(bandIndex, typeIndex));
+
+    b.gainSpeed[i] = getBandParameter(bandIndex, gainSpeedIndex);
+    b.gainMin[i] = getBandParameter(bandIndex, gainMinIndex);
+    b.gainMax[i] = getBandParameter(bandIndex, gainMaxIndex);
+    b.gainDirection[i] = getBandParameter(bandIndex, gainDirectionIndex);
+    b.freqSpeed[i] = getBandParameter(bandIndex, freqSpeedIndex);
+    b.freqMin[i] = getBandParameter(bandIndex, freqMinIndex);
+    b.freqMax[i] = getBandParameter(bandIndex, freqMaxIndex);
+    b.freqLog2Min[i] = std::log2(b.freqMin[i]);
+    b.freqLog2Max[i] = std::log2(b.freqMax[i]);
+    b.freqDirection[i] = getBandParameter(bandIndex, freqDirectionIndex);
+    b.dynamicThreshold[i] = getBandParameter(bandIndex, thresholdIndex);
+    b.dynamicRatio[i] = juce::jmax(1.0f, getBandParameter(bandIndex, ratioIndex));
+    b.dynamicAttack[i] = getBandParameter(bandIndex, attackIndex);
+    b.dynamicRelease[i] = getBandParameter(bandIndex, releaseIndex);
+    detector.setTimes(i, b.dynamicAttack[i], b.dynamicRelease[i]);
 
-    float minGain = *parameters.getRawParameterValue(bandParamNames[bandIndex].gainMin);
-    float maxGain = *parameters.getRawParameterValue(bandParamNames[bandIndex].gainMax);
-    float minFreq = *parameters.getRawParameterValue(bandParamNames[bandIndex].freqMin);
-    float maxFreq = *parameters.getRawParameterValue(bandParamNames[bandIndex].freqMax);
+    // A band that stops being dynamic goes back to its plain gain below.
+    const bool shouldBeDynamic = getBandParameter(bandIndex, dynamicIndex) >= 0.5f;
+    b.dynamic = shouldBeDynamic ? (b.dynamic | bit) : (b.dynamic & ~bit);
 
-    if (bands[bandIndex].prevGain != currentGain ||
-        bands[bandIndex].prevFreq != currentFreq ||
-        bands[bandIndex].prevQ != currentQ ||
-        bands[bandIndex].prevType != currentType)
+    if (b.prevGain[i] != currentGain ||
+        b.prevFreq[i] != currentFreq ||
+        b.prevQ[i] != currentQ ||
+        b.prevType[i] != currentType)
     {
-        coefficientsChanged = true;
+        b.needsUpdate |= bit;
 
-        bands[bandIndex].prevGain = currentGain;
-        bands[bandIndex].prevFreq = currentFreq;
-        bands[bandIndex].prevQ = currentQ;
-        bands[bandIndex].prevType = currentType;
+        b.prevGain[i] = currentGain;
+        b.prevFreq[i] = currentFreq;
+        b.prevQ[i] = currentQ;
+        b.prevType[i] = currentType;
     }
 
-    if ((bands[bandIndex].gainDirection > 0 && currentGain >= maxGain) ||
-        (bands[bandIndex].gainDirection < 0 && currentGain <= minGain))
+    // Starting to drift picks up from wherever the static value sits in the range.
+    const bool gainShouldDrift = b.gainDirection[i] != 0.0f && b.gainMin[i] != b.gainMax[i];
+    const bool freqShouldDrift = b.freqDirection[i] != 0.0f && b.freqMin[i] != b.freqMax[i];
+
+    // A restored preset carries on from its saved phase instead.
+    const bool keepPhase = (restoredDrift & bit) != 0;
+
+    if (gainShouldDrift && ! b.isGainDrifting(i) && ! keepPhase)
+        b.gainDrift[i].setPosition(DriftRange::linearPosition(b.gainMin[i], b.gainMax[i], currentGain));
+
+    if (freqShouldDrift && ! b.isFreqDrifting(i) && ! keepPhase)
+        b.freqDrift[i].setPosition(DriftRange::logPosition(b.freqMin[i], b.freqMax[i], currentFreq));
+
+    if (! gainShouldDrift && b.gainCurrent[i] != currentGain)
     {
-        bands[bandIndex].gainDirection = -bands[bandIndex].gainDirection;
+        b.gainCurrent[i] = currentGain;
+        b.needsUpdate |= bit;
     }
-    if ((bands[bandIndex].freqDirection > 0 && currentFreq >= maxFreq) ||
-        (bands[bandIndex].freqDirection < 0 && currentFreq <= minFreq))
+
+    if (! freqShouldDrift && b.freqStatic[i] != currentFreq)
     {
-        bands[bandIndex].freqDirection = -bands[bandIndex].freqDirection;
+        b.freqStatic[i] = currentFreq;
+        b.freqLog2Current[i] = std::log2(currentFreq);
+        b.needsUpdate |= bit;
     }
 
-    bands[bandIndex].gainCurrent = currentGain;
-    bands[bandIndex].freqCurrent = currentFreq;
-
-    bands[bandIndex].updateCoefficients(getSampleRate());
+    b.gainDrifting = gainShouldDrift ? (b.gainDrifting | bit) : (b.gainDrifting & ~bit);
+    b.freqDrifting = freqShouldDrift ? (b.freqDrifting | bit) : (b.freqDrifting & ~bit);
+    b.Q[i] = currentQ;
+    b.type[i] = currentType;
 }
 
 void EchidnaAudioProcessor::parameterValueChanged(int parameterIndex, float newValue)
 {
+    // Can be called from any thread, including the audio thread during automation.
+    // Latency can only be reported, and the engine only allocated, from the
+    // message thread.
+    if (parameterIndex == linearPhaseParameterIndex)
+    {
+        if (juce::MessageManager::existsAndIsCurrentThread())
+            updateLinearPhase();
+        else
+            triggerAsyncUpdate();
+    }
 
+    const auto affectedBands = bandsForParameterIndex[(size_t) parameterIndex];
+
+    if (affectedBands != 0)
+        dirtyBands.fetch_or(affectedBands);
 }
 
 void EchidnaAudioProcessor::parameterGestureChanged(int, bool)
@@ -256,35 +1049,71 @@ void EchidnaAudioProcessor::parameterGestureChanged(int, bool)
 
 juce::AudioProcessorValueTreeState::ParameterLayout EchidnaAudioProcessor::createParameterLayout()
 {
-    /*  
-        "BAND1GAIN", 
-        "BAND1FREQ", 
-        "BAND1Q", 
-        "BAND1TYPE", 
-        "BAND1GAIN_MIN", 
-        "BAND1GAIN_MAX",
-        "BAND1GAIN_SPEED", 
-        "BAND1GAIN_FREQ_MIN",
-        "BAND1FREQ_MAX", 
-        "BAND1FREQ_SPEED",
-        */
     std::vector<std::unique_ptr<juce::RangedAudioParameter>> params;
-    
-    for (int i = 0; i < 5; ++i) 
-    {
-        params.push_back(std::make_unique<juce::AudioParameterFloat> (bandParamNames[i].gainCurrent, "Band " + juce::String(i) + " Gain", -10.0f, 10.0f, 0.1f));
-        params.push_back(std::make_unique<juce::AudioParameterFloat> (bandParamNames[i].freqCurrent, "Band " + juce::String(i) + " Frequency", 20.0f, 20000.0f, 1000.0f));
-        params.push_back(std::make_unique<juce::AudioParameterFloat> (bandParamNames[i].Q, "Band " + juce::String(i) + " Q", 0.1f, 10.0f, 1.0f));
-        params.push_back(std::make_unique<juce::AudioParameterChoice>(bandParamNames[i].type, "Band " + juce::String(i) + " Type", juce::StringArray{"Bell", "Low Shelf", "High Shelf", "Low Pass", "High Pass"}, 0));
-        params.push_back(std::make_unique<juce::AudioParameterFloat> (bandParamNames[i].gainMin, "Band " + juce::String(i) + " Gain Min", 0.0f, 2.0f, 0.1f));
-        params.push_back(std::make_unique<juce::AudioParameterFloat> (bandParamNames[i].gainMax, "Band " + juce::String(i) + " Gain Max", 0.0f, 2.0f, 0.1f));
-        params.push_back(std::make_unique<juce::AudioParameterFloat> (bandParamNames[i].gainSpeed, "Band " + juce::String(i) + " Gain Speed", 0.001f, 3.0f, 0.01f)); 
-        params.push_back(std::make_unique<juce::AudioParameterFloat> (bandParamNames[i].freqMin, "Band " + juce::String(i) + " Freq Min", 20.0f, 2000.0f, 200.0f));
-        params.push_back(std::make_unique<juce::AudioParameterFloat> (bandParamNames[i].freqMax, "Band " + juce::String(i) + " Freq Max", 20.0f, 2000.0f, 200.0f));
-        params.push_back(std::make_unique<juce::AudioParameterFloat> (bandParamNames[i].freqSpeed, "Band " + juce::String(i) + "Freq Speed", 0.0001f, 1.0f, 0.001f));
-        params.push_back(std::make_unique<juce::AudioParameterFloat> (bandParamNames[i].gainDirection, "Band " + juce::String(i) + "Gain Dir", -1.0f, 1.0f, 0.f));
-        params.push_back(std::make_unique<juce::AudioParameterFloat> (bandParamNames[i].freqDirection, "Band " + juce::String(i) + "Freq Dir", -1.0f, 1.0f, 0.f));
-    }
+
+    // The display names and type choices are shared by every instance too.
+    static const auto bandDisplayNames = []
+    {
+        std::array<std::array<juce::String, numEQBandParameters>, numBands> names;
+
+        for (int band = 0; band < numBands; ++band)
+            for (const auto& spec : bandParameterSpecs)
+                names[(size_t) band][(size_t) spec.index] = "Band " + juce::String(band) + " " + spec.name;
+
+        return names;
+    }();
+
+    static const juce::StringArray typeChoices { "Bell", "Low Shelf", "High Shelf", "Low Pass", "High Pass" };
+
+    const auto addBandParameters = [&params](int band, EQBandParameterIndex first, EQBandParameterIndex end)
+    {
+        for (const auto& spec : bandParameterSpecs)
+        {
+            if (spec.index < first || spec.index >= end)
+                continue;
+
+            const auto& paramID = bandParamNames[(size_t) band].get(spec.index);
+            const auto& name = bandDisplayNames[(size_t) band][(size_t) spec.index];
+
+            switch (spec.kind)
+            {
+            case BandParameterSpec::choice:
+                params.push_back(std::make_unique<juce::AudioParameterChoice>(paramID, name, typeChoices, (int) spec.defaultValue));
+                break;
+            case BandParameterSpec::toggle:
+                params.push_back(std::make_unique<juce::AudioParameterBool>(paramID, name, spec.defaultValue != 0.0f));
+                break;
+            default:
+                params.push_back(std::make_unique<juce::AudioParameterFloat>(paramID, name,
+                                     juce::NormalisableRange<float>(spec.minimum, spec.maximum, 0.0f, spec.skew), spec.defaultValue));
+                break;
+            }
+        }
+    };
+
+    for (int band = 0; band < numBands; ++band)
+        addBandParameters(band, gainCurrentIndex, dynamicIndex);
+
+    juce::StringArray intervalChoices;
+    for (auto interval : controlIntervals)
+        intervalChoices.add(juce::String(interval) + " samples");
+
+    params.push_back(std::make_unique<juce::AudioParameterChoice>("CONTROL_INTERVAL", "Drift Control Interval", intervalChoices, 2));
+    params.push_back(std::make_unique<juce::AudioParameterBool>("TABLE_DESIGN", "Table Coefficient Design", false));
+    params.push_back(std::make_unique<juce::AudioParameterChoice>("FILTER_DESIGN", "Filter Design", juce::StringArray{"Bilinear", "Matched"}, 0));
+    params.push_back(std::make_unique<juce::AudioParameterBool>("MORPH_ENABLED", "Snapshot Morph", false));
+    params.push_back(std::make_unique<juce::AudioParameterFloat>("MORPH", "Snapshot Morph A/B", 0.0f, 1.0f, 0.0f));
+    params.push_back(std::make_unique<juce::AudioParameterBool>("LINEAR_PHASE", "Linear Phase", false));
+
+    // Hosts automate by index, so the dynamics came in after everything above
+    // rather than inside each band's block.
+    for (int band = 0; band < numBands; ++band)
+        addBandParameters(band, dynamicIndex, numEQBandParameters);
+
+    params.push_back(std::make_unique<juce::AudioParameterBool>("SIDECHAIN", "Dynamics Sidechain", false));
+    // Drift speeds count range traversals per beat instead of per second.
+    params.push_back(std::make_unique<juce::AudioParameterBool>("DRIFT_SYNC", "Drift Tempo Sync", false));
+    params.push_back(std::make_unique<juce::AudioParameterChoice>("FILTER_TOPOLOGY", "Filter Topology", juce::StringArray{"Biquad", "State Variable"}, 0));
 
     return { params.begin(), params.end() };
 }
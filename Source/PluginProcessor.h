@@ -9,45 +9,28 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "BandSnapshot.h"
+#include "BiquadCascade.h"
+#include "CoefficientTables.h"
+#include "DynamicsDetector.h"
+#include "EQBandBank.h"
+#include "LinearPhaseEngine.h"
+#include "LoadMeter.h"
+#include "SpectrumAnalyser.h"
+#include "SvfCascade.h"
+#include "TripleBuffer.h"
+
+// How many bands this build of the plug-in has. Each variant is a separate
+// build configuration that defines this along with a plug-in code of its own;
+// everything below is sized from it at compile time.
+#ifndef ECHIDNA_NUM_BANDS
+ #define ECHIDNA_NUM_BANDS 5
+#endif
 
 //==============================================================================
-/**
+/** The IDs of one band's parameters. They're built once per process and shared
+    by every instance, as juce::String is reference counted.
 */
-class ParameterSmoother
-{
-public:
-    ParameterSmoother(float initialValue = 0.0f)
-        : currentValue(initialValue), targetValue(initialValue),
-        increment(0.0f), remainingSamples(0) {}
-    
-    void setTargetValue(float target, int numSamples)
-    {
-        targetValue = target;
-        increment = (targetValue - currentValue) / numSamples;
-        remainingSamples = numSamples;
-    }
-
-    float getNextValue()
-    {
-        if (remainingSamples > 0)
-        {
-            currentValue += increment;
-            --remainingSamples;
-        }
-        else
-        {
-            currentValue = targetValue;
-        }
-        return currentValue;
-    }
-
-    float getCurrentValue() const { return currentValue; }
-
-private:
-    float currentValue, targetValue, increment;
-    int remainingSamples;
-};
-
 struct EQBandParameters
 {
     juce::String gainCurrent;
@@ -62,56 +45,23 @@ struct EQBandParameters
     juce::String freqDirection;
     juce::String Q;
     juce::String type;
-};
+    juce::String dynamic;
+    juce::String threshold;
+    juce::String ratio;
+    juce::String attack;
+    juce::String release;
 
-struct EQBand
-{
-    juce::dsp::IIR::Filter<float> filter;
-    bool needsUpdate = true;
-
-    float gainCurrent = 1.0f;
-    float gainSpeed = 0.0f;
-    float gainMin = 0.0f;
-    float gainMax = 0.0f;
-    float gainDirection = 1.0f;
-    float freqCurrent = 1000.0f;
-    float freqSpeed = 0.0f;
-    float freqMin = 0.0f;
-    float freqMax = 0.0f;
-    float freqDirection = 1.0f;
-    float Q = 1.0f;
-    int type = 0; 
-    float prevGain = 0.0f;
-    float prevFreq = 0.0f;
-    float prevQ = 0.0f;
-    int prevType = -1;
-
-    void updateCoefficients(double sampleRate)
+    const juce::String& get(int index) const
     {
-        switch (type)
-        {
-        case 0: 
-            filter.coefficients = juce::dsp::IIR::Coefficients<float>::makePeakFilter(sampleRate, freqCurrent, Q, gainCurrent);
-            break;
-        case 1:
-            filter.coefficients = juce::dsp::IIR::Coefficients<float>::makeLowShelf(sampleRate, freqCurrent, Q, gainCurrent);
-            break;
-        case 2:
-            filter.coefficients = juce::dsp::IIR::Coefficients<float>::makeHighShelf(sampleRate, freqCurrent, Q, gainCurrent);
-            break;
-        case 3: 
-            filter.coefficients = juce::dsp::IIR::Coefficients<float>::makeLowPass(sampleRate, freqCurrent, Q);
-            break;
-        case 4:
-            filter.coefficients = juce::dsp::IIR::Coefficients<float>::makeHighPass(sampleRate, freqCurrent, Q);
-            break;
-        }
-
-        needsUpdate = false;
+        const juce::String* ids[] = { &gainCurrent, &gainSpeed, &gainMin, &gainMax, &gainDirection,
+                                      &freqCurrent, &freqSpeed, &freqMin, &freqMax, &freqDirection,
+                                      &Q, &type, &dynamic, &threshold, &ratio, &attack, &release };
+        return *ids[index];
     }
 };
 
-class EchidnaAudioProcessor  : public juce::AudioProcessor, public juce::AudioProcessorParameter::Listener
+class EchidnaAudioProcessor  : public juce::AudioProcessor, public juce::AudioProcessorParameter::Listener,
+                               private juce::AsyncUpdater
                             #if JucePlugin_Enable_ARA
                              , public juce::AudioProcessorARAExtension
                             #endif
@@ -121,8 +71,8 @@ public:
     //==============================================================================
     EchidnaAudioProcessor();
     ~EchidnaAudioProcessor() override;
-    void parameterValueChanged(int parameterIndex, float newValue);
-    void parameterGestureChanged(int, bool);
+    void parameterValueChanged(int parameterIndex, float newValue) override;
+    void parameterGestureChanged(int, bool) override;
 
     //==============================================================================
     void prepareToPlay (double sampleRate, int samplesPerBlock) override;
@@ -133,6 +83,8 @@ public:
    #endif
 
     void processBlock (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
+    void processBlock (juce::AudioBuffer<double>&, juce::MidiBuffer&) override;
+    bool supportsDoublePrecisionProcessing() const override;
 
     //==============================================================================
     juce::AudioProcessorEditor* createEditor() override;
@@ -158,16 +110,261 @@ public:
     void setStateInformation (const void* data, int sizeInBytes) override;
 
     juce::AudioProcessorValueTreeState& getValueTreeState() { return parameters; }
-    static const std::array<EQBandParameters, 5> bandParamNames;
+    static constexpr int numBands = ECHIDNA_NUM_BANDS;
+    static_assert(numBands == 3 || numBands == 5 || numBands == 8, "Echidna ships in 3, 5 and 8 band variants");
+    static_assert(numBands <= LinearPhaseEngine::maxStages, "the linear-phase kernel can't hold every band");
+    static const std::array<EQBandParameters, numBands> bandParamNames;
     void UpdateBandParameters(int bandIndex);
+
+    static constexpr std::array<int, 4> controlIntervals { 8, 16, 32, 64 };
+
+    /** How much of the real-time budget processBlock has been using, split into
+        parameter updates, coefficient design and filtering. Safe to call from
+        any thread.
+    */
+    ProcessLoadMeter::Statistics getLoadStatistics() const { return loadMeter.getStatistics(); }
+    void resetLoadStatistics() { loadMeter.requestReset(); }
+
+    /** A/B snapshots of every band parameter. The MORPH parameter blends between
+        the two while MORPH_ENABLED is on. Storing captures the current parameter
+        values; recalling sets the parameters to a snapshot, and the audio thread
+        glides to it. Message thread only.
+    */
+    static constexpr int numSnapshotSlots = 2;
+    void storeSnapshot(int slot);
+    void recallSnapshot(int slot);
+
+    /** The coefficients the audio thread is filtering with right now, and where
+        each band currently sits in its drift.
+    */
+    struct ResponseSnapshot
+    {
+        double sampleRate = 0.0;
+        BiquadCoefficients<double> coefficients[numBands];
+        bool enabled[numBands] {};
+        double frequency[numBands] {};
+    };
+
+    /** While at least one listener is registered, the audio thread publishes a
+        ResponseSnapshot at the end of every block in which a band changed.
+        With none, it publishes nothing.
+    */
+    void addResponseListener();
+    void removeResponseListener();
+
+    /** Picks up the newest published response, returning true if there was a new
+        one. Only one thread may consume responses, normally the message thread.
+    */
+    bool updateResponse() { return publishedResponse.update(); }
+    const ResponseSnapshot& getResponse() const { return publishedResponse.getReadBuffer(); }
+
+    /** Input and output spectra for the editor; see SpectrumAnalyser. */
+    SpectrumAnalyser& getAnalyser() { return analyser; }
+
 private:
-    EQBand bands[5];
-    std::array<ParameterSmoother, 5> gainSmoothers;
-    std::array<ParameterSmoother, 5> freqSmoothers;
+    static constexpr juce::uint32 allBandsMask = EQBandBank<numBands>::allBandsMask;
+
+    using Snapshot = BandSnapshot<numBands>;
+
+    /** The value a band works towards: the parameter itself, or the A/B blend
+        while morphing, and part way there from the previous values during a
+        recall glide.
+    */
+    float getBandParameter(int bandIndex, int parameterIndex) const
+    {
+        float value;
+
+        if (morphing)
+        {
+            const auto& slots = stateMessages.getReadBuffer().slots;
+            value = Snapshot::interpolate(parameterIndex, slots[0].get(bandIndex, parameterIndex),
+                                          slots[1].get(bandIndex, parameterIndex), morphPosition);
+        }
+        else
+        {
+            value = parameterHandles[(size_t) (bandIndex * numEQBandParameters + parameterIndex)]->load(std::memory_order_relaxed);
+        }
+
+        if (glidePosition < 1.0f)
+            value = Snapshot::interpolate(parameterIndex, glideFrom.get(bandIndex, parameterIndex), value, glidePosition);
+
+        return value;
+    }
+
+    Snapshot captureParameters() const;
+    Snapshot captureBands() const;
+    void pushStateMessage();
+
+    // Saved state starts with this, followed by stateVersion. Version 2 added
+    // the drift time the phases were saved at.
+    static constexpr int stateMagic = 0x53484345; // "ECHS"
+    static constexpr int stateVersion = 2;
+    // How long a recalled preset takes to glide in.
+    static constexpr double glideSeconds = 0.03;
+
+    // Below this (about -140 dBFS) input counts as silent and filter state as decayed.
+    static constexpr double silenceThreshold = 1.0e-7;
+    // The reported tail covers the cascade's impulse response falling this far.
+    static constexpr double tailDecibels = 120.0;
+
+    template <typename SampleType>
+    void processSamples(juce::AudioBuffer<SampleType>& buffer, BiquadCascade<SampleType, numBands>& cascade,
+                        SvfCascade<SampleType, numBands>& svf);
+
+    template <typename SampleType>
+    void runControlTick(BiquadCascade<SampleType, numBands>& cascade, SvfCascade<SampleType, numBands>& svf,
+                        juce::int64 tickSample, int numSamplesInTick);
+
+    /** Redesigns the cascade's flagged bands with whichever design is selected. */
+    template <typename SampleType>
+    void designBiquads(BiquadCascade<SampleType, numBands>& cascade);
+
+    /** Works out where this block starts on the timeline drift is computed from. */
+    void updateTimeline();
+
+    template <typename SampleType>
+    void publishResponse(BiquadCascade<SampleType, numBands>& cascade);
+
+    template <typename SampleType>
+    void requestLinearPhaseKernel(const BiquadCascade<SampleType, numBands>& cascade);
+
+    /** Reports the linear-phase latency once the engine is ready, or none,
+        and only then lets the audio thread switch over. Message thread only.
+    */
+    void updateLatency();
+
+    /** Sets the linear-phase engine up or stands it down to match the parameter,
+        and reports the latency. Message thread only.
+    */
+    void updateLinearPhase();
+    void handleAsyncUpdate() override;
+
+    EQBandBank<numBands> bands;
+    // Coefficients and per-channel delay lines of the bands, kept together for the
+    // audio loop. Only the one matching the host's processing precision is used.
+    BiquadCascade<float, numBands> floatCascade;
+    BiquadCascade<double, numBands> doubleCascade;
+
+    // With FILTER_TOPOLOGY on State Variable, the bands run as SVFs whose
+    // coefficients ramp every sample instead. They always use the bilinear
+    // designs, so FILTER_DESIGN is ignored while they're in use. The biquad
+    // coefficients are then only designed when the editor wants a response
+    // to draw, for the bands in biquadStale.
+    std::atomic<float>* topologyHandle = nullptr;
+    SvfCascade<float, numBands> floatSvf;
+    SvfCascade<double, numBands> doubleSvf;
+    bool useSvf = false;
+    bool svfNeedsSnap = true;
+    juce::uint32 biquadStale = 0;
+
+    // The biquads ramp to each tick's designs over the samples up to the next
+    // one, except after a reset, when there is nothing to ramp from.
+    bool biquadNeedsSnap = true;
+
+    // Drift and coefficient updates happen every controlInterval samples on a
+    // grid that carries across blocks, so the update rate doesn't depend on the
+    // host buffer size.
+    std::atomic<float>* controlIntervalHandle = nullptr;
+    std::atomic<float>* tableDesignHandle = nullptr;
+    std::atomic<float>* filterDesignHandle = nullptr;
+    std::shared_ptr<const CoefficientTables> coefficientTables;
+    bool useTableDesign = false;
+    bool useMatchedDesign = false;
+    int controlInterval = 32;
+    int samplesUntilControlTick = 0;
+
+    // Drift is a function of the timeline, in seconds or, with DRIFT_SYNC on,
+    // in beats. While the host is playing, the timeline is its transport
+    // position; otherwise it carries on from the last block. Control ticks
+    // sit on multiples of the interval along it, so any render of the same
+    // stretch of timeline updates the same samples with the same values.
+    std::atomic<float>* driftSyncHandle = nullptr;
+    bool driftSynced = false;
+    juce::int64 blockStartSample = 0;
+    juce::int64 nextBlockSample = 0;
+    double blockStartBeats = 0.0;
+    double beatsPerSample = 0.0;
+    double lastDriftTime = 0.0;
+    double lastBpm = 120.0;
+    // Written on the audio thread whenever a band changes, read by the host.
+    std::atomic<double> tailSeconds { 0.0 };
+    ProcessLoadMeter loadMeter;
+
+    // Dynamic bands listen to a mono sum of the main input, or of the sidechain
+    // bus while SIDECHAIN is on and the host has connected it. The sum is built
+    // a slice at a time, and slices never exceed the longest control interval.
+    std::atomic<float>* sidechainHandle = nullptr;
+    DynamicsDetector<numBands> detector;
+    float detectorInput[controlIntervals.back()] {};
+    SpectrumAnalyser analyser;
+
+    // Linear-phase mode replaces the cascade with an FIR built from its
+    // response; see LinearPhaseEngine. Processing in double still convolves in float.
+    std::atomic<float>* linearPhaseHandle = nullptr;
+    int linearPhaseParameterIndex = -1;
+    LinearPhaseEngine linearPhase;
+    // Set while the host has been told about the engine's latency. The audio
+    // thread follows this rather than the parameter, so the path it takes
+    // always has the latency the host is compensating for.
+    std::atomic<bool> linearPhaseReported { false };
+    bool linearPhaseActive = false;
+    bool kernelChanged = true;
+
+    /** Everything the message thread hands to the audio thread in one go. */
+    struct StateMessage
+    {
+        Snapshot slots[numSnapshotSlots];
+        double gainDriftPhase[numBands] {};
+        double freqDriftPhase[numBands] {};
+        // Version 1 states don't have it, and resume from wherever they're loaded.
+        double driftTime = 0.0;
+        bool hasDriftTime = false;
+    };
+
+    struct DriftPhases
+    {
+        double time = 0.0;
+        double gain[numBands] {};
+        double freq[numBands] {};
+    };
+
+    // Message side: the authoritative snapshots, and the lock that keeps
+    // callers from different non-audio threads out of each other's way.
+    juce::CriticalSection stateLock;
+    StateMessage messageState;
+    TripleBuffer<StateMessage> stateMessages;
+    TripleBuffer<DriftPhases> publishedDrift;
+    std::atomic<bool> glideRequested { false };
+    std::atomic<bool> driftRestoreRequested { false };
+
+    // Audio side.
+    std::atomic<float>* morphEnabledHandle = nullptr;
+    std::atomic<float>* morphHandle = nullptr;
+    bool morphing = false;
+    float morphPosition = 0.0f;
+    Snapshot glideFrom;
+    int glideLength = 1;
+    int glideSamplesRemaining = 0;
+    float glidePosition = 1.0f;
+    TripleBuffer<ResponseSnapshot> publishedResponse;
+    std::atomic<int> numResponseListeners { 0 };
+    std::atomic<bool> responseRefreshRequested { false };
+    bool responseChanged = true;
+
+    // Bands whose drift phase was just restored, so starting to drift mustn't
+    // move them back to their static value.
+    juce::uint32 restoredDrift = 0;
     
     juce::AudioProcessorValueTreeState parameters;
     juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
 
+    // Resolved once in the constructor so the audio thread never hashes parameter IDs.
+    std::array<std::atomic<float>*, numBands * numEQBandParameters> parameterHandles {};
+    // Maps AudioProcessorParameter indices to a mask of the bands they affect.
+    std::vector<juce::uint32> bandsForParameterIndex;
+    // One bit per band, set by parameterValueChanged and consumed by processBlock.
+    std::atomic<juce::uint32> dirtyBands { allBandsMask };
+
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (EchidnaAudioProcessor)
 };
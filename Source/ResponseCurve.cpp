@@ -0,0 +1,167 @@
+/*
+  ==============================================================================
+
+    ResponseCurve.cpp
+    Live magnitude response of the band cascade, drawn from published coefficients.
+
+  ==============================================================================
+*/
+
+#include "ResponseCurve.h"
+
+ResponseCurve::ResponseCurve (EchidnaAudioProcessor& p)
+    : audioProcessor (p)
+{
+    sinSquaredHalfOmega.resize ((size_t) numPoints);
+    decibels.resize ((size_t) numPoints);
+
+    audioProcessor.addResponseListener();
+    startTimerHz (60);
+}
+
+ResponseCurve::~ResponseCurve()
+{
+    audioProcessor.removeResponseListener();
+}
+
+void ResponseCurve::timerCallback()
+{
+    if (audioProcessor.updateResponse())
+    {
+        hasResponse = true;
+        rebuildPath();
+        repaint();
+    }
+}
+
+void ResponseCurve::resized()
+{
+    rebuildPath();
+}
+
+/** The grid points are evenly spaced in log frequency, so the trigonometry only
+    changes with the sample rate.
+*/
+void ResponseCurve::updateGrid (double sampleRate)
+{
+    if (sampleRate == gridSampleRate)
+        return;
+
+    gridSampleRate = sampleRate;
+
+    for (int i = 0; i < numPoints; ++i)
+    {
+        const auto frequency = minFrequency * std::pow (maxFrequency / minFrequency, i / (double) (numPoints - 1));
+        const auto omega = juce::MathConstants<double>::twoPi * juce::jmin (frequency, 0.5 * sampleRate) / sampleRate;
+
+        sinSquaredHalfOmega[(size_t) i] = juce::square (std::sin (0.5 * omega));
+    }
+}
+
+/** |H(w)|^2 as a ratio of quadratics in phi = sin^2(w/2), the form the RBJ
+    cookbook gives. The same ratio in cos w and cos 2w has terms of order one
+    that cancel down to the size of w^4 near DC, which loses the low bands
+    completely in float and most of their digits in double. Here the only
+    cancellation is in folding the coefficients, once per band.
+*/
+void ResponseCurve::addBandDecibels (const BiquadCoefficients<double>& c, const double* sinSquaredHalfOmega,
+                                     float* decibels, int numPoints)
+{
+    const auto bSum = c.b0 + c.b1 + c.b2;
+    const auto aSum = 1.0 + c.a1 + c.a2;
+    const auto B0 = bSum * bSum;
+    const auto B1 = -4.0 * (c.b1 * (c.b0 + c.b2) + 4.0 * c.b0 * c.b2);
+    const auto B2 = 16.0 * c.b0 * c.b2;
+    const auto A0 = aSum * aSum;
+    const auto A1 = -4.0 * (c.a1 * (1.0 + c.a2) + 4.0 * c.a2);
+    const auto A2 = 16.0 * c.a2;
+
+    for (int i = 0; i < numPoints; ++i)
+    {
+        const auto phi = sinSquaredHalfOmega[i];
+        const auto squared = (B0 + phi * (B1 + phi * B2)) / juce::jmax (1.0e-300, A0 + phi * (A1 + phi * A2));
+        decibels[i] += (float) (10.0 * std::log10 (juce::jmax (1.0e-24, squared)));
+    }
+}
+
+void ResponseCurve::rebuildPath()
+{
+    responsePath.clear();
+    bandMarkers.clearQuick();
+
+    if (! hasResponse || getWidth() <= 0)
+        return;
+
+    const auto& response = audioProcessor.getResponse();
+
+    if (response.sampleRate <= 0.0)
+        return;
+
+    updateGrid (response.sampleRate);
+    std::fill (decibels.begin(), decibels.end(), 0.0f);
+
+    for (int band = 0; band < EchidnaAudioProcessor::numBands; ++band)
+        if (response.enabled[band])
+            addBandDecibels (response.coefficients[band], sinSquaredHalfOmega.data(), decibels.data(), numPoints);
+
+    const auto width = (float) getWidth();
+
+    for (int i = 0; i < numPoints; ++i)
+    {
+        const auto x = width * (float) i / (float) (numPoints - 1);
+        const auto y = decibelsToY (decibels[(size_t) i]);
+
+        if (i == 0)
+            responsePath.startNewSubPath (x, y);
+        else
+            responsePath.lineTo (x, y);
+    }
+
+    // Each marker sits on the combined curve at the band's current frequency.
+    for (int band = 0; band < EchidnaAudioProcessor::numBands; ++band)
+    {
+        const auto frequency = juce::jlimit (minFrequency, maxFrequency, response.frequency[band]);
+        double total = 1.0;
+
+        for (int other = 0; other < EchidnaAudioProcessor::numBands; ++other)
+            if (response.enabled[other])
+                total *= BiquadDesigner::getMagnitudeForFrequency (response.coefficients[other], frequency, response.sampleRate);
+
+        bandMarkers.add ({ frequencyToX (frequency), decibelsToY ((float) juce::Decibels::gainToDecibels (total)) });
+    }
+}
+
+float ResponseCurve::frequencyToX (double frequency) const
+{
+    return (float) getWidth() * (float) (std::log (frequency / minFrequency) / std::log (maxFrequency / minFrequency));
+}
+
+float ResponseCurve::decibelsToY (float decibelValue) const
+{
+    const auto height = (float) getHeight();
+    return juce::jlimit (0.0f, height, height * 0.5f * (1.0f - decibelValue / decibelRange));
+}
+
+void ResponseCurve::paint (juce::Graphics& g)
+{
+    // Transparent, so that the analyser can be drawn underneath.
+    g.setColour (juce::Colours::darkgrey);
+
+    for (auto frequency : { 100.0, 1000.0, 10000.0 })
+        g.drawVerticalLine (juce::roundToInt (frequencyToX (frequency)), 0.0f, (float) getHeight());
+
+    for (auto decibelValue : { -12.0f, 0.0f, 12.0f })
+        g.drawHorizontalLine (juce::roundToInt (decibelsToY (decibelValue)), 0.0f, (float) getWidth());
+
+    g.setColour (juce::Colours::orange);
+    g.strokePath (responsePath, juce::PathStrokeType (2.0f));
+
+    const auto& response = audioProcessor.getResponse();
+
+    for (int band = 0; band < bandMarkers.size(); ++band)
+    {
+        const auto marker = bandMarkers[band];
+        g.setColour (response.enabled[band] ? juce::Colours::white : juce::Colours::grey);
+        g.fillEllipse (marker.x - 4.0f, marker.y - 4.0f, 8.0f, 8.0f);
+    }
+}
@@ -0,0 +1,63 @@
+/*
+  ==============================================================================
+
+    ResponseCurve.h
+    Live magnitude response of the band cascade, drawn from published coefficients.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+
+//==============================================================================
+/** Draws the combined response of every enabled band, and a marker at each
+    band's current frequency, from the coefficients the audio thread publishes.
+
+    A timer polls for a new ResponseSnapshot at 60 Hz, and the magnitudes and
+    the path are only recomputed when one has arrived or the component has been
+    resized. Each band is evaluated over the whole log-frequency grid in one
+    loop, using sin^2(w/2) tabulated for the grid.
+*/
+class ResponseCurve  : public juce::Component, private juce::Timer
+{
+public:
+    explicit ResponseCurve (EchidnaAudioProcessor&);
+    ~ResponseCurve() override;
+
+    void paint (juce::Graphics&) override;
+    void resized() override;
+
+    static constexpr double minFrequency = 20.0;
+    static constexpr double maxFrequency = 20000.0;
+    static constexpr float decibelRange = 24.0f;
+
+    /** Adds the band's magnitude in decibels to each of numPoints values, given
+        sin^2(w/2) at each point.
+    */
+    static void addBandDecibels (const BiquadCoefficients<double>& coefficients, const double* sinSquaredHalfOmega,
+                                 float* decibels, int numPoints);
+
+private:
+    static constexpr int numPoints = 256;
+
+    void timerCallback() override;
+    void updateGrid (double sampleRate);
+    void rebuildPath();
+
+    float frequencyToX (double frequency) const;
+    float decibelsToY (float decibels) const;
+
+    EchidnaAudioProcessor& audioProcessor;
+
+    double gridSampleRate = 0.0;
+    std::vector<double> sinSquaredHalfOmega;
+    std::vector<float> decibels;
+    juce::Path responsePath;
+    juce::Array<juce::Point<float>> bandMarkers;
+    bool hasResponse = false;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ResponseCurve)
+};
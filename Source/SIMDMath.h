@@ -0,0 +1,72 @@
+/*
+  ==============================================================================
+
+    SIMDMath.h
+    Polynomial approximations of exp2, sin and cos on SIMD registers.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/** Fast transcendental functions built from the multiplies and adds that
+    juce::dsp::SIMDRegister provides, for control-rate work done on every band
+    at once. Each one is only valid over the range it documents.
+*/
+namespace SIMDMath
+{
+    using FloatRegister = juce::dsp::SIMDRegister<float>;
+
+    /** 2^x for 0 <= x <= 32, with a relative error below 1e-5.
+
+        Evaluates e^t for |t| <= ln(2) / 2 with a degree 7 Taylor polynomial,
+        which gives 2^(x / 32), and squares that five times.
+    */
+    inline FloatRegister exp2(FloatRegister x)
+    {
+        const auto t = (x - 16.0f) * (0.69314718f / 32.0f);
+
+        auto r = FloatRegister::expand(1.0f / 5040.0f);
+        r = r * t + 1.0f / 720.0f;
+        r = r * t + 1.0f / 120.0f;
+        r = r * t + 1.0f / 24.0f;
+        r = r * t + 1.0f / 6.0f;
+        r = r * t + 0.5f;
+        r = r * t + 1.0f;
+        r = r * t + 1.0f;
+
+        // 2^(x / 32) = sqrt(2) * e^t
+        r = r * juce::MathConstants<float>::sqrt2;
+
+        for (int i = 0; i < 5; ++i)
+            r = r * r;
+
+        return r;
+    }
+
+    /** sin(x) for 0 <= x <= pi / 2, absolute error below 2e-7. */
+    inline FloatRegister sin(FloatRegister x)
+    {
+        const auto x2 = x * x;
+
+        auto r = FloatRegister::expand(-1.0f / 39916800.0f);
+        r = r * x2 + 1.0f / 362880.0f;
+        r = r * x2 - 1.0f / 5040.0f;
+        r = r * x2 + 1.0f / 120.0f;
+        r = r * x2 - 1.0f / 6.0f;
+        r = r * x2 + 1.0f;
+
+        return r * x;
+    }
+
+    /** cos(x) for 0 <= x <= pi / 2, evaluated as sin(pi / 2 - x) so that the
+        relative error stays small as the result approaches zero.
+    */
+    inline FloatRegister cos(FloatRegister x)
+    {
+        return sin(FloatRegister::expand(juce::MathConstants<float>::halfPi) - x);
+    }
+}
@@ -0,0 +1,119 @@
+/*
+  ==============================================================================
+
+    SpectrumAnalyser.cpp
+    Input and output spectra, computed on a background thread.
+
+  ==============================================================================
+*/
+
+#include "SpectrumAnalyser.h"
+
+SpectrumAnalyser::SpectrumAnalyser()
+{
+    for (auto& level : smoothed.input)
+        level = floorDecibels;
+
+    for (auto& level : smoothed.output)
+        level = floorDecibels;
+}
+
+SpectrumAnalyser::~SpectrumAnalyser()
+{
+    setEnabled(false);
+}
+
+void SpectrumAnalyser::prepare(double newSampleRate)
+{
+    sampleRate.store(newSampleRate);
+}
+
+void SpectrumAnalyser::setEnabled(bool shouldBeEnabled)
+{
+    if (shouldBeEnabled == enabled.load())
+        return;
+
+    if (shouldBeEnabled)
+    {
+        if (buffers == nullptr)
+            buffers = std::make_unique<Buffers>();
+
+        enabled.store(true, std::memory_order_release);
+        thread->addTimeSliceClient(this);
+    }
+    else
+    {
+        // Once the client is removed the background thread is done with the
+        // FIFO; whatever the audio thread still writes is simply left in it.
+        enabled.store(false);
+        thread->removeTimeSliceClient(this);
+    }
+}
+
+int SpectrumAnalyser::useTimeSlice()
+{
+    int start1Read, size1Read, start2Read, size2Read;
+    fifo.prepareToRead(fifo.getNumReady(), start1Read, size1Read, start2Read, size2Read);
+    auto& b = *buffers;
+
+    for (const auto [start, size] : { std::pair { start1Read, size1Read }, std::pair { start2Read, size2Read } })
+    {
+        for (int i = 0; i < size; ++i)
+        {
+            b.inputHistory[(size_t) historyPosition] = b.inputRing[(size_t) (start + i)];
+            b.outputHistory[(size_t) historyPosition] = b.outputRing[(size_t) (start + i)];
+            historyPosition = (historyPosition + 1) % fftSize;
+
+            if (++samplesSinceAnalysis >= hopSize)
+            {
+                samplesSinceAnalysis = 0;
+                analyse();
+            }
+        }
+    }
+
+    fifo.finishedRead(size1Read + size2Read);
+
+    // About 60 checks a second, enough to keep up with a hop of 1024 samples at 48 kHz.
+    return 16;
+}
+
+void SpectrumAnalyser::analyse()
+{
+    const auto rate = sampleRate.load();
+    // Hann window coherent gain is 0.5, and a full-scale sine puts half its
+    // energy in each of the two mirrored bins.
+    const auto normalisation = 4.0f / (float) fftSize;
+    // Level falls by about 20 dB per second at one analysis per hop; rises are immediate.
+    const auto fall = (float) (20.0 * hopSize / rate);
+    auto& b = *buffers;
+    auto& fftData = b.fftData;
+
+    for (int side = 0; side < 2; ++side)
+    {
+        const auto& history = side == 0 ? b.inputHistory : b.outputHistory;
+        auto* levels = side == 0 ? smoothed.input : smoothed.output;
+
+        // Oldest sample first.
+        for (int i = 0; i < fftSize; ++i)
+            fftData[(size_t) i] = history[(size_t) ((historyPosition + i) % fftSize)];
+
+        b.window.multiplyWithWindowingTable(fftData.data(), (size_t) fftSize);
+        b.fft.performFrequencyOnlyForwardTransform(fftData.data(), true);
+
+        for (int point = 0; point < numPoints; ++point)
+        {
+            const auto frequency = minFrequency * std::pow(maxFrequency / minFrequency, point / (double) (numPoints - 1));
+            const auto bin = juce::jlimit(0.0, (double) (fftSize / 2 - 1), frequency * fftSize / rate);
+            const auto index = juce::jmin((int) bin, fftSize / 2 - 2);
+            const auto fraction = (float) (bin - index);
+            const auto magnitude = fftData[(size_t) index] + fraction * (fftData[(size_t) index + 1] - fftData[(size_t) index]);
+            const auto level = juce::Decibels::gainToDecibels(magnitude * normalisation, floorDecibels);
+
+            levels[point] = juce::jmax(level, levels[point] - fall);
+        }
+    }
+
+    spectra.getWriteBuffer() = smoothed;
+    spectra.publish();
+}
@@ -0,0 +1,150 @@
+/*
+  ==============================================================================
+
+    SpectrumAnalyser.h
+    Input and output spectra, computed on a background thread.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "BackgroundThread.h"
+#include "TripleBuffer.h"
+
+//==============================================================================
+/** Measures the spectrum of the processor's input and output, mixed to mono.
+
+    The audio thread writes both signals into a lock-free single-producer,
+    single-consumer FIFO: the input before the cascade runs and the output
+    after, into the same region. A background thread drains the FIFO,
+    runs a Hann-windowed FFT every hopSize samples, and smooths the result on
+    a log-frequency grid before handing it to the message thread through a
+    TripleBuffer. The thread is the SharedBackgroundThread, and an analyser is
+    only attached to it while enabled.
+
+    While the analyser is disabled, the audio thread just reads one flag per
+    block. The FIFO, history and FFT take about 300 kB, so they are only
+    allocated the first time the analyser is enabled, and an instance whose
+    analyser is never shown doesn't carry them.
+*/
+class SpectrumAnalyser  : private juce::TimeSliceClient
+{
+public:
+    static constexpr int fftOrder = 11;
+    static constexpr int fftSize = 1 << fftOrder;
+    static constexpr int hopSize = fftSize / 2;
+    static constexpr int numPoints = 256;
+    static constexpr double minFrequency = 20.0;
+    static constexpr double maxFrequency = 20000.0;
+    static constexpr float floorDecibels = -120.0f;
+
+    /** Levels in dB at numPoints frequencies, evenly spaced in log frequency
+        from minFrequency to maxFrequency.
+    */
+    struct Spectrum
+    {
+        float input[numPoints] {};
+        float output[numPoints] {};
+    };
+
+    SpectrumAnalyser();
+    ~SpectrumAnalyser() override;
+
+    /** Call from prepareToPlay. */
+    void prepare(double sampleRate);
+
+    //==============================================================================
+    /** Message thread only. */
+    void setEnabled(bool shouldBeEnabled);
+    bool isEnabled() const { return enabled.load(std::memory_order_relaxed); }
+
+    /** Message thread only: picks up the newest spectrum, returning true if there
+        was a new one.
+    */
+    bool updateSpectrum() { return spectra.update(); }
+    const Spectrum& getSpectrum() const { return spectra.getReadBuffer(); }
+
+    //==============================================================================
+    /** Audio thread: takes the block's input. Returns false, having done nothing,
+        if the analyser is disabled; otherwise pushOutput must follow once the
+        block has been processed.
+    */
+    template <typename SampleType>
+    bool pushInput(const SampleType* const* channelData, int numChannels, int numSamples)
+    {
+        // Acquire, so the buffers allocated before enabling are visible.
+        if (! enabled.load(std::memory_order_acquire))
+            return false;
+
+        // If the background thread has fallen behind, the rest of the block is dropped.
+        fifo.prepareToWrite(numSamples, start1, size1, start2, size2);
+        mixDown(buffers->inputRing.data(), channelData, numChannels);
+        return true;
+    }
+
+    template <typename SampleType>
+    void pushOutput(const SampleType* const* channelData, int numChannels)
+    {
+        mixDown(buffers->outputRing.data(), channelData, numChannels);
+        fifo.finishedWrite(size1 + size2);
+    }
+
+private:
+    static constexpr int fifoSize = 1 << 15;
+
+    int useTimeSlice() override;
+    void analyse();
+
+    template <typename SampleType>
+    void mixDown(float* ring, const SampleType* const* channelData, int numChannels)
+    {
+        const auto gain = 1.0f / (float) juce::jmax(1, numChannels);
+
+        for (int i = 0; i < size1 + size2; ++i)
+        {
+            float sum = 0.0f;
+
+            for (int channel = 0; channel < numChannels; ++channel)
+                sum += (float) channelData[channel][i];
+
+            ring[i < size1 ? start1 + i : start2 + i - size1] = sum * gain;
+        }
+    }
+
+    juce::SharedResourcePointer<SharedBackgroundThread> thread;
+    std::atomic<bool> enabled { false };
+    std::atomic<double> sampleRate { 44100.0 };
+
+    struct Buffers
+    {
+        // Written by the audio thread, read by the background thread.
+        std::vector<float> inputRing = std::vector<float>((size_t) fifoSize);
+        std::vector<float> outputRing = std::vector<float>((size_t) fifoSize);
+
+        // Background thread only.
+        juce::dsp::FFT fft { fftOrder };
+        juce::dsp::WindowingFunction<float> window { (size_t) fftSize, juce::dsp::WindowingFunction<float>::hann, false };
+        std::vector<float> inputHistory = std::vector<float>((size_t) fftSize);
+        std::vector<float> outputHistory = std::vector<float>((size_t) fftSize);
+        std::vector<float> fftData = std::vector<float>((size_t) fftSize * 2);
+    };
+
+    // Created by the first setEnabled(true) and kept from then on, since the
+    // audio thread may still be reading it just after a disable.
+    std::unique_ptr<Buffers> buffers;
+
+    // Written by the audio thread, read by the background thread.
+    juce::AbstractFifo fifo { fifoSize };
+    int start1 = 0, size1 = 0, start2 = 0, size2 = 0;
+
+    // Background thread only.
+    int historyPosition = 0;
+    int samplesSinceAnalysis = 0;
+    Spectrum smoothed;
+
+    TripleBuffer<Spectrum> spectra;
+
+    JUCE_DECLARE_NON_COPYABLE (SpectrumAnalyser)
+};
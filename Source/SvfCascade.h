@@ -0,0 +1,320 @@
+/*
+  ==============================================================================
+
+    SvfCascade.h
+    Trapezoidal state-variable filters with coefficients ramped every sample.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "BiquadCascade.h"
+#include "BiquadDesigner.h"
+
+//==============================================================================
+/** One band as a trapezoidal (TPT) state-variable filter, after Andrew
+    Simper's "Linear Trap Optimised 2" SVF. g is the prewarped integrator gain
+    tan(w/2), k the damping, and the output mixes the input, band-pass and
+    low-pass signals by m0, m1 and m2.
+
+    Its states are the integrators' charge rather than past outputs, so any
+    positive g and k make a stable filter, including while they move. A ramp
+    between two designs is a sequence of valid designs, and nothing can build
+    up and blow out however fast the band is modulated.
+*/
+template <typename SampleType>
+struct SvfCoefficients
+{
+    SampleType g = 0, k = 2, m0 = 1, m1 = 0, m2 = 0;
+};
+
+namespace SvfDesigner
+{
+    /** The same responses as the bilinear designs in BiquadDesigner, from
+        tan(w/2) of the band frequency.
+    */
+    template <typename SampleType>
+    inline void designFromTan(SvfCoefficients<SampleType>& c, int type, SampleType tanHalf, SampleType Q, SampleType gainFactor)
+    {
+        const auto k = 1 / Q;
+
+        switch (type)
+        {
+        case BiquadDesigner::bell:
+        {
+            const auto A = std::sqrt(BiquadDesigner::limitGain(gainFactor));
+            const auto kA = k / A;
+            c = { tanHalf, kA, 1, kA * (A * A - 1), 0 };
+            break;
+        }
+        case BiquadDesigner::lowShelf:
+        {
+            const auto A = std::sqrt(BiquadDesigner::limitGain(gainFactor));
+            c = { tanHalf / std::sqrt(A), k, 1, k * (A - 1), A * A - 1 };
+            break;
+        }
+        case BiquadDesigner::highShelf:
+        {
+            const auto A = std::sqrt(BiquadDesigner::limitGain(gainFactor));
+            c = { tanHalf * std::sqrt(A), k, A * A, k * (1 - A) * A, 1 - A * A };
+            break;
+        }
+        case BiquadDesigner::lowPass:
+            c = { tanHalf, k, 0, 0, 1 };
+            break;
+        case BiquadDesigner::highPass:
+            c = { tanHalf, k, 1, -k, -1 };
+            break;
+        default:
+            c = {};
+            break;
+        }
+    }
+
+    template <typename SampleType>
+    inline void design(SvfCoefficients<SampleType>& c, int type, double sampleRate, SampleType frequency, SampleType Q, SampleType gainFactor)
+    {
+        const auto halfOmega = juce::MathConstants<SampleType>::pi * BiquadDesigner::limitFrequency(sampleRate, frequency)
+                             / static_cast<SampleType> (sampleRate);
+
+        designFromTan(c, type, std::tan(halfOmega), Q, gainFactor);
+    }
+}
+
+//==============================================================================
+/** The bands as a chain of state-variable filters, the alternative to
+    BiquadCascade for fast modulation.
+
+    Designs arrive as targets once per control tick. Each stage then moves its
+    coefficients linearly from where they are to the target over the samples
+    up to the next tick, and works out its filter gains from them on every
+    sample. That costs one division per stage per sample, which is far less
+    than redesigning a biquad per sample, so drift moves the response smoothly
+    without zipper steps.
+
+    Channels are processed a register's worth at a time, one per SIMD lane, the
+    same way as in BiquadCascade. A stage that's switched off is simply skipped:
+    only transparent bands are switched off, and an SVF close to unity passes
+    its input through whatever its state, so nothing needs fading.
+*/
+template <typename SampleType, int NumStages>
+struct SvfCascade
+{
+    using Lanes = ChannelLanes<SampleType>;
+
+    static constexpr int maxChannels = BiquadCascade<SampleType, NumStages>::maxChannels;
+    static constexpr int numLanes = (int) Lanes::SIMDNumElements;
+    static constexpr int maxGroups = (maxChannels + numLanes - 1) / numLanes;
+
+    /** Integrator states, ic1eq and ic2eq in Simper's notation. */
+    struct State
+    {
+        Lanes ic1 {}, ic2 {};
+    };
+
+    alignas (64) State states[maxGroups][NumStages];
+    // Written by the control tick, picked up by the next startRamp().
+    SvfCoefficients<SampleType> targets[NumStages];
+
+    void prepare()
+    {
+        for (auto& e : enabled)
+            e = true;
+
+        reset();
+        snapToTargets();
+    }
+
+    void reset()
+    {
+        for (auto& group : states)
+            for (auto& state : group)
+                state = {};
+    }
+
+    /** Jumps straight to the targets, for when there is nothing to ramp from. */
+    void snapToTargets()
+    {
+        for (int i = 0; i < NumStages; ++i)
+        {
+            current[i] = targets[i];
+            step[i] = {};
+        }
+
+        rampSamplesRemaining = 0;
+    }
+
+    /** Starts every stage moving towards its target, arriving numSamples from now. */
+    void startRamp(int numSamples)
+    {
+        const auto scale = static_cast<SampleType> (1) / (SampleType) juce::jmax(1, numSamples);
+
+        for (int i = 0; i < NumStages; ++i)
+        {
+            const auto& from = current[i];
+            const auto& to = targets[i];
+            step[i] = { (to.g - from.g) * scale, (to.k - from.k) * scale, (to.m0 - from.m0) * scale,
+                        (to.m1 - from.m1) * scale, (to.m2 - from.m2) * scale };
+        }
+
+        // Bands that aren't moving don't need the per-sample steps at all.
+        const bool moving = std::any_of(std::begin(step), std::end(step), [](const auto& d)
+        {
+            return d.g != 0 || d.k != 0 || d.m0 != 0 || d.m1 != 0 || d.m2 != 0;
+        });
+
+        rampSamplesRemaining = moving ? numSamples : 0;
+    }
+
+    void setStageEnabled(int stage, bool shouldBeEnabled)
+    {
+        // A stage coming back starts from rest.
+        if (shouldBeEnabled && ! enabled[stage])
+            for (auto& group : states)
+                group[stage] = {};
+
+        enabled[stage] = shouldBeEnabled;
+    }
+
+    bool isSilent(SampleType threshold, int numChannels = maxChannels) const
+    {
+        const int numGroups = juce::jmin(maxGroups, (numChannels + numLanes - 1) / numLanes);
+
+        for (int group = 0; group < numGroups; ++group)
+            for (const auto& state : states[group])
+                for (size_t lane = 0; lane < Lanes::SIMDNumElements; ++lane)
+                    if (std::abs(state.ic1.get(lane)) > threshold || std::abs(state.ic2.get(lane)) > threshold)
+                        return false;
+
+        return true;
+    }
+
+    void process(SampleType* const* channelData, int numChannels, int startSample, int numSamples)
+    {
+        jassert(numChannels <= maxChannels);
+
+        int active[NumStages];
+        int numActive = 0;
+
+        for (int i = 0; i < NumStages; ++i)
+            if (enabled[i])
+                active[numActive++] = i;
+
+        // A ramp ends at the next control tick and slices never cross one, so
+        // the split is only a safeguard for callers that ramp over less.
+        const int numRamped = juce::jmin(numSamples, rampSamplesRemaining);
+
+        if (numRamped > 0)
+        {
+            (this->*kernels[(size_t) numActive])(active, channelData, numChannels, startSample, numRamped, true);
+            rampSamplesRemaining -= numRamped;
+
+            if (rampSamplesRemaining == 0)
+                snapToTargets();
+        }
+
+        if (numSamples > numRamped)
+            (this->*kernels[(size_t) numActive])(active, channelData, numChannels, startSample + numRamped, numSamples - numRamped, false);
+    }
+
+private:
+    using Kernel = void (SvfCascade::*)(const int*, SampleType* const*, int, int, int, bool);
+
+    bool enabled[NumStages] {};
+    SvfCoefficients<SampleType> current[NumStages];
+    SvfCoefficients<SampleType> step[NumStages];
+    int rampSamplesRemaining = 0;
+
+    /** Runs Count stages over every channel group. Each group replays the same
+        ramp from the coefficients the slice started with, and the stages only
+        keep where the ramp got to once all groups are done.
+    */
+    template <int Count>
+    void processStages(const int* active, SampleType* const* channelData, int numChannels, int startSample, int numSamples, bool ramping)
+    {
+        if constexpr (Count > 0)
+        {
+            SvfCoefficients<SampleType> c[Count];
+
+            for (int group = 0; group * numLanes < numChannels; ++group)
+            {
+                const auto first = group * numLanes;
+                const auto numInGroup = juce::jmin(numLanes, numChannels - first);
+
+                Lanes ic1[Count], ic2[Count];
+
+                for (int k = 0; k < Count; ++k)
+                {
+                    c[k] = current[active[k]];
+                    ic1[k] = states[group][active[k]].ic1;
+                    ic2[k] = states[group][active[k]].ic2;
+                }
+
+                alignas (Lanes::SIMDRegisterSize) SampleType frame[Lanes::SIMDNumElements] = {};
+
+                for (int sample = startSample; sample < startSample + numSamples; ++sample)
+                {
+                    for (int channel = 0; channel < numInGroup; ++channel)
+                        frame[channel] = channelData[first + channel][sample];
+
+                    auto x = Lanes::fromRawArray(frame);
+
+                    unrolled([&](int k)
+                    {
+                        if (ramping)
+                        {
+                            const auto& d = step[active[k]];
+                            c[k] = { c[k].g + d.g, c[k].k + d.k, c[k].m0 + d.m0, c[k].m1 + d.m1, c[k].m2 + d.m2 };
+                        }
+
+                        const auto a1 = static_cast<SampleType> (1) / (1 + c[k].g * (c[k].g + c[k].k));
+                        const auto a2 = c[k].g * a1;
+                        const auto a3 = c[k].g * a2;
+
+                        const auto v3 = x - ic2[k];
+                        const auto v1 = ic1[k] * a1 + v3 * a2;
+                        const auto v2 = ic2[k] + ic1[k] * a2 + v3 * a3;
+                        ic1[k] = v1 * (SampleType) 2 - ic1[k];
+                        ic2[k] = v2 * (SampleType) 2 - ic2[k];
+
+                        x = x * c[k].m0 + v1 * c[k].m1 + v2 * c[k].m2;
+                    }, std::make_integer_sequence<int, Count>());
+
+                    x.copyToRawArray(frame);
+
+                    for (int channel = 0; channel < numInGroup; ++channel)
+                        channelData[first + channel][sample] = frame[channel];
+                }
+
+                for (int k = 0; k < Count; ++k)
+                {
+                    states[group][active[k]].ic1 = ic1[k];
+                    states[group][active[k]].ic2 = ic2[k];
+                }
+            }
+
+            // With no channels the ramp still has to move on.
+            for (int k = 0; k < Count; ++k)
+            {
+                auto& s = current[active[k]];
+                const auto& d = step[active[k]];
+                const auto n = (SampleType) (ramping ? numSamples : 0);
+                s = { s.g + d.g * n, s.k + d.k * n, s.m0 + d.m0 * n, s.m1 + d.m1 * n, s.m2 + d.m2 * n };
+            }
+        }
+        else
+        {
+            juce::ignoreUnused(active, channelData, numChannels, startSample, numSamples, ramping);
+        }
+    }
+
+    template <size_t... Counts>
+    static constexpr std::array<Kernel, sizeof...(Counts)> makeKernels(std::index_sequence<Counts...>)
+    {
+        return { &SvfCascade::processStages<(int) Counts>... };
+    }
+
+    static constexpr std::array<Kernel, NumStages + 1> kernels = makeKernels(std::make_index_sequence<NumStages + 1>());
+};
@@ -0,0 +1,69 @@
+/*
+  ==============================================================================
+
+    TripleBuffer.h
+    Wait-free hand-over of the latest value from one thread to another.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/** Passes whole values from a single producer to a single consumer.
+
+    There are three slots: one the producer is filling, one the consumer is
+    reading, and one in the middle holding the newest published value. Each
+    side swaps its slot with the middle one in a single atomic exchange, so
+    neither side ever waits, copies or allocates. The consumer only ever sees
+    the latest value; anything published in between is dropped.
+
+    T is default constructed in all three slots, so the consumer reads a
+    default value until the first publish() arrives.
+*/
+template <typename T>
+class TripleBuffer
+{
+public:
+    /** Producer side: the slot to fill before calling publish(). It holds
+        whatever was in it last, not necessarily the last value published.
+    */
+    T& getWriteBuffer()
+    {
+        return slots[(size_t) writeIndex];
+    }
+
+    void publish()
+    {
+        writeIndex = middle.exchange(writeIndex | newDataBit, std::memory_order_acq_rel) & indexMask;
+    }
+
+    /** Consumer side: picks up the newest value if there is one, and returns
+        true if it did.
+    */
+    bool update()
+    {
+        if ((middle.load(std::memory_order_relaxed) & newDataBit) == 0)
+            return false;
+
+        readIndex = middle.exchange(readIndex, std::memory_order_acq_rel) & indexMask;
+        return true;
+    }
+
+    /** Consumer side: the value picked up by the last update(). */
+    const T& getReadBuffer() const
+    {
+        return slots[(size_t) readIndex];
+    }
+
+private:
+    static constexpr int indexMask = 3;
+    static constexpr int newDataBit = 4;
+
+    std::array<T, 3> slots {};
+    int writeIndex = 0;
+    int readIndex = 1;
+    std::atomic<int> middle { 2 };
+};
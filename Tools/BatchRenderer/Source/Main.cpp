@@ -0,0 +1,393 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+    Headless batch renderer that runs audio files through EchidnaAudioProcessor.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../../Source/PluginProcessor.h"
+
+//==============================================================================
+struct RenderSettings
+{
+    juce::File outputDirectory;
+    // Parameter IDs and plain (not normalised) values, applied in order.
+    std::vector<std::pair<juce::String, float>> parameterValues;
+    int blockSize = 512;
+    int chunkSize = 65536;
+    bool doublePrecision = false;
+    bool renderTail = false;
+    double tempo = 120.0;
+};
+
+/** Reads a preset in the same form as the plug-in's parameter tree:
+    <PARAMETERS><PARAM id="BAND1_GAIN" value="1.5"/>...</PARAMETERS>
+*/
+static bool loadPreset(const juce::File& file, RenderSettings& settings)
+{
+    auto xml = juce::XmlDocument::parse(file);
+
+    if (xml == nullptr)
+        return false;
+
+    for (auto* param : xml->getChildWithTagNameIterator("PARAM"))
+        settings.parameterValues.emplace_back(param->getStringAttribute("id"), (float) param->getDoubleAttribute("value"));
+
+    return true;
+}
+
+static juce::String applyParameters(EchidnaAudioProcessor& processor, const RenderSettings& settings)
+{
+    for (const auto& [paramID, value] : settings.parameterValues)
+    {
+        auto* parameter = processor.getValueTreeState().getParameter(paramID);
+
+        if (parameter == nullptr)
+            return "unknown parameter " + paramID;
+
+        parameter->setValueNotifyingHost(parameter->convertTo0to1(value));
+    }
+
+    return {};
+}
+
+//==============================================================================
+/** A transport playing the file from its first sample at a fixed tempo, so
+    drift lands exactly where it would in a host playing the file from the
+    start of its timeline.
+*/
+class RenderPlayHead : public juce::AudioPlayHead
+{
+public:
+    RenderPlayHead(double renderSampleRate, double renderTempo)
+        : sampleRate(renderSampleRate), tempo(renderTempo)
+    {
+    }
+
+    juce::Optional<PositionInfo> getPosition() const override
+    {
+        PositionInfo info;
+        info.setIsPlaying(true);
+        info.setTimeInSamples(position);
+        info.setTimeInSeconds((double) position / sampleRate);
+        info.setBpm(tempo);
+        info.setPpqPosition((double) position / sampleRate * tempo / 60.0);
+        return info;
+    }
+
+    juce::int64 position = 0;
+
+private:
+    double sampleRate;
+    double tempo;
+};
+
+/** Runs a chunk through the processor in host-sized blocks, starting at the
+    given position in the file.
+*/
+template <typename SampleType>
+static void processChunk(EchidnaAudioProcessor& processor, RenderPlayHead& playHead, juce::int64 chunkPosition,
+                         juce::AudioBuffer<SampleType>& chunk, int numSamples, int blockSize)
+{
+    juce::MidiBuffer midi;
+
+    for (int start = 0; start < numSamples; start += blockSize)
+    {
+        juce::AudioBuffer<SampleType> block(chunk.getArrayOfWritePointers(), chunk.getNumChannels(), start,
+                                            juce::jmin(blockSize, numSamples - start));
+        playHead.position = chunkPosition + start;
+        processor.processBlock(block, midi);
+    }
+}
+
+//==============================================================================
+/** Renders one file, streaming it through in chunks so that memory use doesn't
+    depend on the file's length. Each job owns its own processor instance.
+*/
+class RenderJob : public juce::ThreadPoolJob
+{
+public:
+    RenderJob(const juce::File& inputFile, const juce::File& outputFileToWrite, const RenderSettings& renderSettings,
+              juce::CriticalSection& outputLock)
+        : juce::ThreadPoolJob(inputFile.getFileName()), input(inputFile), outputFile(outputFileToWrite),
+          settings(renderSettings), consoleLock(outputLock)
+    {
+    }
+
+    JobStatus runJob() override
+    {
+        const auto startTime = juce::Time::getMillisecondCounterHiRes();
+        double audioSeconds = 0.0;
+        const auto error = render(audioSeconds);
+        const auto elapsedSeconds = (juce::Time::getMillisecondCounterHiRes() - startTime) * 0.001;
+
+        const juce::ScopedLock sl(consoleLock);
+
+        if (error.isNotEmpty())
+        {
+            failed = true;
+            std::cerr << input.getFullPathName() << ": " << error << std::endl;
+        }
+        else
+        {
+            std::cout << input.getFullPathName() << ": " << juce::String(audioSeconds, 2) << " s of audio in "
+                      << juce::String(elapsedSeconds, 3) << " s, "
+                      << juce::String(audioSeconds / juce::jmax(elapsedSeconds, 1.0e-9), 1) << "x real time" << std::endl;
+        }
+
+        return jobHasFinished;
+    }
+
+    bool hasFailed() const { return failed; }
+
+private:
+    juce::String render(double& audioSeconds)
+    {
+        juce::AudioFormatManager formats;
+        formats.registerBasicFormats();
+
+        std::unique_ptr<juce::AudioFormatReader> reader(formats.createReaderFor(input));
+
+        if (reader == nullptr)
+            return "not a readable audio file";
+
+        const auto numChannels = (int) reader->numChannels;
+        const auto sampleRate = reader->sampleRate;
+        const auto length = reader->lengthInSamples;
+        audioSeconds = (double) length / sampleRate;
+
+        EchidnaAudioProcessor processor;
+
+        juce::AudioProcessor::BusesLayout layout;
+        layout.inputBuses.add(juce::AudioChannelSet::canonicalChannelSet(numChannels));
+        layout.outputBuses.add(juce::AudioChannelSet::canonicalChannelSet(numChannels));
+        layout.inputBuses.add(juce::AudioChannelSet::disabled()); // sidechain
+
+        if (! processor.setBusesLayout(layout))
+            return juce::String(numChannels) + " channels are not supported";
+
+        const auto parameterError = applyParameters(processor, settings);
+
+        if (parameterError.isNotEmpty())
+            return parameterError;
+
+        RenderPlayHead playHead(sampleRate, settings.tempo);
+        processor.setPlayHead(&playHead);
+        processor.setNonRealtime(true);
+        processor.setProcessingPrecision(settings.doublePrecision ? juce::AudioProcessor::doublePrecision
+                                                                   : juce::AudioProcessor::singlePrecision);
+        processor.setRateAndBufferSizeDetails(sampleRate, settings.blockSize);
+        processor.prepareToPlay(sampleRate, settings.blockSize);
+
+        auto* format = formats.findFormatForFileExtension(input.getFileExtension());
+
+        if (outputFile == input)
+            return "output would overwrite the input";
+
+        if (! outputFile.getParentDirectory().createDirectory())
+            return "can't create " + outputFile.getParentDirectory().getFullPathName();
+
+        outputFile.deleteFile();
+        auto stream = outputFile.createOutputStream();
+
+        if (stream == nullptr)
+            return "can't write " + outputFile.getFullPathName();
+
+        std::unique_ptr<juce::AudioFormatWriter> writer(format->createWriterFor(stream.get(), sampleRate, (unsigned int) numChannels,
+                                                                                (int) reader->bitsPerSample, reader->metadataValues, 0));
+
+        if (writer == nullptr)
+            return "can't create a " + format->getFormatName() + " writer";
+
+        stream.release(); // now owned by the writer
+
+        juce::AudioBuffer<float> chunk(numChannels, settings.chunkSize);
+        juce::AudioBuffer<double> doubleChunk(settings.doublePrecision ? numChannels : 0, settings.chunkSize);
+
+        // The processor works out its tail on its first control tick, so this is
+        // asked again as the render goes.
+        const auto tailSamples = [&]
+        {
+            return settings.renderTail ? (juce::int64) std::ceil(processor.getTailLengthSeconds() * sampleRate) : 0;
+        };
+
+        // Linear-phase mode delays the output, so that much more is rendered and
+        // the start is dropped to keep the file aligned with its input.
+        const auto latency = (juce::int64) processor.getLatencySamples();
+
+        for (juce::int64 position = 0; position < length + tailSamples() + latency; position += settings.chunkSize)
+        {
+            if (shouldExit())
+                return "cancelled";
+
+            const auto numSamples = (int) juce::jmin((juce::int64) settings.chunkSize, length + tailSamples() + latency - position);
+
+            // Past the end of the file the reader fills with silence, which renders the tail.
+            reader->read(&chunk, 0, numSamples, position, true, true);
+
+            if (settings.doublePrecision)
+            {
+                doubleChunk.makeCopyOf(chunk, true);
+                processChunk(processor, playHead, position, doubleChunk, numSamples, settings.blockSize);
+                chunk.makeCopyOf(doubleChunk, true);
+            }
+            else
+            {
+                processChunk(processor, playHead, position, chunk, numSamples, settings.blockSize);
+            }
+
+            const auto skip = (int) juce::jlimit((juce::int64) 0, (juce::int64) numSamples, latency - position);
+
+            if (skip < numSamples && ! writer->writeFromAudioSampleBuffer(chunk, skip, numSamples - skip))
+                return "write failed";
+        }
+
+        processor.releaseResources();
+        return {};
+    }
+
+    juce::File input, outputFile;
+    const RenderSettings& settings;
+    juce::CriticalSection& consoleLock;
+    bool failed = false;
+};
+
+//==============================================================================
+static void printUsage()
+{
+    std::cout << "Usage: EchidnaBatchRenderer --output=<dir> [options] <files or directories>...\n"
+                 "\n"
+                 "  --output=<dir>      where rendered files are written, under their original names\n"
+                 "                      and, for directories, their paths below the directory\n"
+                 "  --preset=<file>     parameter preset, <PARAMETERS><PARAM id=\"..\" value=\"..\"/></PARAMETERS>\n"
+                 "  --set=<ID>=<value>  sets one parameter, after the preset; may be repeated\n"
+                 "  --block=<samples>   host block size, default 512\n"
+                 "  --threads=<n>       worker threads, default one per CPU core\n"
+                 "  --double            process in double precision\n"
+                 "  --tail              append the filters' tail after the end of the input\n"
+                 "  --tempo=<bpm>       transport tempo for tempo-synced drift, default 120\n"
+                 "\n"
+                 "Directories are searched recursively for .wav and .flac files." << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+    juce::ArgumentList args(argc, argv);
+
+    if (args.size() == 0 || args.containsOption("--help|-h"))
+    {
+        printUsage();
+        return 0;
+    }
+
+    RenderSettings settings;
+    settings.outputDirectory = juce::File::getCurrentWorkingDirectory().getChildFile(args.getValueForOption("--output"));
+    const auto requestedBlockSize = args.getValueForOption("--block").getIntValue();
+    settings.blockSize = requestedBlockSize > 0 ? requestedBlockSize : 512;
+    settings.chunkSize = juce::jmax(settings.chunkSize, settings.blockSize);
+    settings.doublePrecision = args.containsOption("--double");
+    settings.renderTail = args.containsOption("--tail");
+    const auto requestedTempo = args.getValueForOption("--tempo").getDoubleValue();
+    settings.tempo = requestedTempo > 0.0 ? requestedTempo : 120.0;
+
+    if (args.getValueForOption("--output").isEmpty() || ! settings.outputDirectory.createDirectory())
+    {
+        std::cerr << "An output directory is needed (--output=<dir>)" << std::endl;
+        return 1;
+    }
+
+    // Each input with where its render goes. Files found in a directory keep
+    // their path below it, so that same-named files in different folders
+    // don't land on each other.
+    juce::Array<juce::File> inputs, outputs;
+
+    for (const auto& arg : args.arguments)
+    {
+        if (arg.isOption())
+        {
+            if (arg.getLongOptionValue().isEmpty() && arg.text != "--double" && arg.text != "--tail")
+            {
+                std::cerr << "Options take their value after '=': " << arg.text << std::endl;
+                return 1;
+            }
+
+            if (arg.isLongOption("preset") && ! loadPreset(juce::File::getCurrentWorkingDirectory().getChildFile(arg.getLongOptionValue()), settings))
+            {
+                std::cerr << "Can't read preset " << arg.getLongOptionValue() << std::endl;
+                return 1;
+            }
+
+            if (arg.isLongOption("set"))
+            {
+                const auto assignment = arg.getLongOptionValue();
+                settings.parameterValues.emplace_back(assignment.upToFirstOccurrenceOf("=", false, false),
+                                                      assignment.fromFirstOccurrenceOf("=", false, false).getFloatValue());
+            }
+
+            continue;
+        }
+
+        const auto file = arg.resolveAsFile();
+
+        if (file.isDirectory())
+        {
+            for (const auto& found : file.findChildFiles(juce::File::findFiles, true, "*.wav;*.flac"))
+            {
+                inputs.add(found);
+                outputs.add(settings.outputDirectory.getChildFile(found.getRelativePathFrom(file)));
+            }
+        }
+        else if (file.existsAsFile())
+        {
+            inputs.add(file);
+            outputs.add(settings.outputDirectory.getChildFile(file.getFileName()));
+        }
+        else
+        {
+            std::cerr << "Skipping " << arg.text << ": no such file" << std::endl;
+        }
+    }
+
+    // Inputs named separately can still share a name, and two jobs writing
+    // one file at once would leave neither render in it.
+    for (int i = 0; i < outputs.size(); ++i)
+    {
+        const auto first = outputs.indexOf(outputs[i]);
+
+        if (first != i)
+        {
+            std::cerr << inputs[i].getFullPathName() << " and " << inputs[first].getFullPathName()
+                      << " would both be written to " << outputs[i].getFullPathName() << std::endl;
+            return 1;
+        }
+    }
+
+    const auto requestedThreads = args.getValueForOption("--threads").getIntValue();
+    const auto numThreads = requestedThreads > 0 ? requestedThreads : juce::SystemStats::getNumCpus();
+
+    juce::CriticalSection consoleLock;
+    juce::ThreadPool pool(numThreads);
+    juce::OwnedArray<RenderJob> jobs;
+
+    const auto startTime = juce::Time::getMillisecondCounterHiRes();
+
+    for (int i = 0; i < inputs.size(); ++i)
+        pool.addJob(jobs.add(new RenderJob(inputs[i], outputs[i], settings, consoleLock)), false);
+
+    int numFailed = 0;
+
+    for (auto* job : jobs)
+    {
+        pool.waitForJobToFinish(job, -1);
+        numFailed += job->hasFailed() ? 1 : 0;
+    }
+
+    std::cout << "Rendered " << (jobs.size() - numFailed) << " of " << jobs.size() << " files on " << numThreads
+              << " threads in " << juce::String((juce::Time::getMillisecondCounterHiRes() - startTime) * 0.001, 2) << " s" << std::endl;
+
+    return numFailed == 0 ? 0 : 1;
+}
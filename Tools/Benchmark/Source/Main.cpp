@@ -0,0 +1,745 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+    Micro-benchmarks for the processor and its DSP building blocks, as JSON.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../../Source/PluginProcessor.h"
+
+#if JUCE_LINUX
+ #include <malloc.h>
+#elif JUCE_MAC
+ #include <malloc/malloc.h>
+#elif JUCE_WINDOWS
+ #ifndef NOMINMAX
+  #define NOMINMAX
+ #endif
+ #include <windows.h>
+#endif
+
+//==============================================================================
+/*  Every new and delete in the benchmark goes through these, so the memory
+    section can see what an instance costs. The size is kept in front of each
+    block so that live bytes can be followed as well as the number of
+    allocations. juce::HeapBlock, and so AudioBuffer, calls malloc directly and
+    never comes through here; HeapCounter::getMallocBytes() asks the C library
+    instead, and covers both.
+*/
+namespace HeapCounter
+{
+    constexpr std::size_t headerSize = alignof(std::max_align_t);
+
+    std::atomic<juce::int64> liveBytes { 0 };
+    std::atomic<juce::int64> numAllocations { 0 };
+
+    /** Bytes the C heap has handed out and not had back, or -1 where the
+        platform can't say.
+    */
+    juce::int64 getMallocBytes()
+    {
+       #if JUCE_LINUX && defined (__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+        // Large blocks are mapped separately and only show up in hblkhd.
+        const auto info = mallinfo2();
+        return (juce::int64) (info.uordblks + info.hblkhd);
+       #elif JUCE_MAC
+        malloc_statistics_t statistics;
+        malloc_zone_statistics(nullptr, &statistics);
+        return (juce::int64) statistics.size_in_use;
+       #elif JUCE_WINDOWS
+        // The CRT's malloc has used the process heap since VS2015.
+        HEAP_SUMMARY summary {};
+        summary.cb = sizeof(summary);
+        return HeapSummary(GetProcessHeap(), 0, &summary) ? (juce::int64) summary.cbAllocated : -1;
+       #else
+        return -1;
+       #endif
+    }
+}
+
+void* operator new(std::size_t size)
+{
+    auto* block = static_cast<char*>(std::malloc(size + HeapCounter::headerSize));
+
+    if (block == nullptr)
+        throw std::bad_alloc();
+
+    *reinterpret_cast<std::size_t*>(block) = size;
+    HeapCounter::liveBytes += (juce::int64) size;
+    ++HeapCounter::numAllocations;
+    return block + HeapCounter::headerSize;
+}
+
+void operator delete(void* pointer) noexcept
+{
+    if (pointer == nullptr)
+        return;
+
+    auto* block = static_cast<char*>(pointer) - HeapCounter::headerSize;
+    HeapCounter::liveBytes -= (juce::int64) *reinterpret_cast<std::size_t*>(block);
+    std::free(block);
+}
+
+// Over-aligned types, such as the processor with its SIMD state, come through
+// here. The block's start and size sit just before the aligned pointer.
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    const auto align = juce::jmax((std::size_t) alignment, 2 * sizeof(std::size_t));
+    auto* block = static_cast<char*>(std::malloc(size + align + 2 * sizeof(std::size_t)));
+
+    if (block == nullptr)
+        throw std::bad_alloc();
+
+    const auto address = (reinterpret_cast<std::uintptr_t>(block) + 2 * sizeof(std::size_t) + align - 1) & ~(std::uintptr_t) (align - 1);
+    auto* header = reinterpret_cast<std::size_t*>(address) - 2;
+    header[0] = reinterpret_cast<std::uintptr_t>(block);
+    header[1] = size;
+    HeapCounter::liveBytes += (juce::int64) size;
+    ++HeapCounter::numAllocations;
+    return reinterpret_cast<void*>(address);
+}
+
+void operator delete(void* pointer, std::align_val_t) noexcept
+{
+    if (pointer == nullptr)
+        return;
+
+    auto* header = static_cast<std::size_t*>(pointer) - 2;
+    HeapCounter::liveBytes -= (juce::int64) header[1];
+    std::free(reinterpret_cast<void*>(header[0]));
+}
+
+void* operator new[](std::size_t size)                                   { return operator new(size); }
+void* operator new[](std::size_t size, std::align_val_t alignment)       { return operator new(size, alignment); }
+void operator delete[](void* pointer) noexcept                           { operator delete(pointer); }
+void operator delete[](void* pointer, std::align_val_t alignment) noexcept { operator delete(pointer, alignment); }
+void operator delete(void* pointer, std::size_t) noexcept                { operator delete(pointer); }
+void operator delete[](void* pointer, std::size_t) noexcept              { operator delete(pointer); }
+void operator delete(void* pointer, std::size_t, std::align_val_t alignment) noexcept   { operator delete(pointer, alignment); }
+void operator delete[](void* pointer, std::size_t, std::align_val_t alignment) noexcept { operator delete(pointer, alignment); }
+
+//==============================================================================
+namespace
+{
+    constexpr double sampleRate = 48000.0;
+    constexpr int numBands = EchidnaAudioProcessor::numBands;
+    const char* const typeNames[] = { "bell", "lowShelf", "highShelf", "lowPass", "highPass" };
+
+    struct Options
+    {
+        double secondsPerRound = 0.02;
+        int numRounds = 5;
+        bool quick = false;
+    };
+
+    /** Seconds per call of fn, from the fastest of several rounds. Each round
+        runs long enough for the clock's resolution not to matter.
+    */
+    template <typename Function>
+    double timePerCall(const Options& options, Function&& fn)
+    {
+        using Clock = std::chrono::steady_clock;
+
+        const auto timeCalls = [&fn](int numCalls)
+        {
+            const auto start = Clock::now();
+
+            for (int i = 0; i < numCalls; ++i)
+                fn();
+
+            return std::chrono::duration<double>(Clock::now() - start).count();
+        };
+
+        int numCalls = 1;
+
+        while (timeCalls(numCalls) < options.secondsPerRound * 0.25 && numCalls < (1 << 28))
+            numCalls *= 2;
+
+        numCalls = juce::jmax(1, (int) (numCalls * options.secondsPerRound / juce::jmax(1.0e-9, timeCalls(numCalls))));
+
+        auto best = std::numeric_limits<double>::max();
+
+        for (int round = 0; round < options.numRounds; ++round)
+            best = juce::jmin(best, timeCalls(numCalls) / numCalls);
+
+        return best;
+    }
+
+    /** Filters are run on a fresh copy of the same noise every call so that a
+        boosting band can't grow the signal without bound. The copy on its own
+        is timed too and taken off.
+    */
+    template <typename SampleType, typename Function>
+    double timePerCallWithFreshInput(const Options& options, const juce::AudioBuffer<SampleType>& source,
+                                     juce::AudioBuffer<SampleType>& work, Function&& fn)
+    {
+        const auto copy = [&]
+        {
+            for (int channel = 0; channel < source.getNumChannels(); ++channel)
+                work.copyFrom(channel, 0, source, channel, 0, source.getNumSamples());
+        };
+
+        const auto total = timePerCall(options, [&] { copy(); fn(); });
+        const auto copyOnly = timePerCall(options, copy);
+
+        return juce::jmax(0.0, total - copyOnly);
+    }
+
+    template <typename SampleType>
+    juce::AudioBuffer<SampleType> makeNoise(int numChannels, int numSamples)
+    {
+        juce::AudioBuffer<SampleType> buffer(numChannels, numSamples);
+        juce::Random random(1234);
+
+        for (int channel = 0; channel < numChannels; ++channel)
+            for (int i = 0; i < numSamples; ++i)
+                buffer.setSample(channel, i, (SampleType) (random.nextFloat() * 0.5f - 0.25f));
+
+        return buffer;
+    }
+
+    juce::var makeObject(std::initializer_list<std::pair<const char*, juce::var>> properties)
+    {
+        auto* object = new juce::DynamicObject();
+
+        for (const auto& [name, value] : properties)
+            object->setProperty(name, value);
+
+        return juce::var(object);
+    }
+
+    //==============================================================================
+    void setParameter(EchidnaAudioProcessor& processor, const juce::String& paramID, float value)
+    {
+        auto* parameter = processor.getValueTreeState().getParameter(paramID);
+        parameter->setValueNotifyingHost(parameter->convertTo0to1(value));
+    }
+
+    /** Every band gets the same type, at frequencies two octaves apart and with
+        enough gain that none of them is bypassed as transparent.
+    */
+    void configureBands(EchidnaAudioProcessor& processor, int type, bool drift)
+    {
+        for (int band = 0; band < numBands; ++band)
+        {
+            const auto& names = EchidnaAudioProcessor::bandParamNames[(size_t) band];
+
+            setParameter(processor, names.type, (float) type);
+            setParameter(processor, names.gainCurrent, 2.0f);
+            setParameter(processor, names.freqCurrent, 60.0f * std::pow(4.0f, (float) band));
+            setParameter(processor, names.Q, 0.707f);
+            setParameter(processor, names.gainMin, 0.5f);
+            setParameter(processor, names.gainMax, 2.0f);
+            setParameter(processor, names.gainSpeed, 1.0f);
+            setParameter(processor, names.gainDirection, drift ? 1.0f : 0.0f);
+            setParameter(processor, names.freqMin, 100.0f);
+            setParameter(processor, names.freqMax, 2000.0f);
+            setParameter(processor, names.freqSpeed, 0.5f);
+            setParameter(processor, names.freqDirection, drift ? 1.0f : 0.0f);
+        }
+    }
+
+    struct ProcessBlockCase
+    {
+        bool doublePrecision = false;
+        juce::String design = "bilinear";
+        int numChannels = 2;
+        int blockSize = 512;
+        int type = 0;
+        bool drift = false;
+        bool dynamic = false;
+    };
+
+    template <typename SampleType>
+    juce::var benchmarkProcessBlock(const Options& options, const ProcessBlockCase& c)
+    {
+        EchidnaAudioProcessor processor;
+
+        juce::AudioProcessor::BusesLayout layout;
+        layout.inputBuses.add(juce::AudioChannelSet::canonicalChannelSet(c.numChannels));
+        layout.outputBuses.add(juce::AudioChannelSet::canonicalChannelSet(c.numChannels));
+        layout.inputBuses.add(juce::AudioChannelSet::disabled()); // sidechain
+
+        if (! processor.setBusesLayout(layout))
+            return {};
+
+        configureBands(processor, c.type, c.drift);
+
+        // Low enough that the noise keeps every band cutting.
+        for (const auto& names : EchidnaAudioProcessor::bandParamNames)
+        {
+            setParameter(processor, names.dynamic, c.dynamic ? 1.0f : 0.0f);
+            setParameter(processor, names.threshold, -50.0f);
+        }
+
+        setParameter(processor, "TABLE_DESIGN", c.design == "table" ? 1.0f : 0.0f);
+        setParameter(processor, "FILTER_DESIGN", c.design == "matched" ? 1.0f : 0.0f);
+        setParameter(processor, "FILTER_TOPOLOGY", c.design == "svf" ? 1.0f : 0.0f);
+
+        processor.setProcessingPrecision(c.doublePrecision ? juce::AudioProcessor::doublePrecision
+                                                           : juce::AudioProcessor::singlePrecision);
+        processor.setRateAndBufferSizeDetails(sampleRate, c.blockSize);
+        processor.prepareToPlay(sampleRate, c.blockSize);
+
+        const auto source = makeNoise<SampleType>(c.numChannels, c.blockSize);
+        juce::AudioBuffer<SampleType> work(c.numChannels, c.blockSize);
+        juce::MidiBuffer midi;
+
+        const auto seconds = timePerCallWithFreshInput(options, source, work, [&] { processor.processBlock(work, midi); });
+        const auto nsPerSample = seconds * 1.0e9 / c.blockSize;
+
+        processor.releaseResources();
+
+        return makeObject({ { "precision", c.doublePrecision ? "double" : "float" },
+                            { "design", c.design },
+                            { "channels", c.numChannels },
+                            { "blockSize", c.blockSize },
+                            { "type", typeNames[c.type] },
+                            { "drift", c.drift },
+                            { "dynamic", c.dynamic },
+                            { "nsPerSample", nsPerSample },
+                            { "nsPerChannelSample", nsPerSample / c.numChannels } });
+    }
+
+    juce::var benchmarkProcessBlocks(const Options& options)
+    {
+        juce::Array<juce::var> results;
+
+        std::vector<int> blockSizes;
+        for (int size = 1; size <= 8192; size *= 2)
+            if (! options.quick || size == 1 || size == 64 || size == 512 || size == 8192)
+                blockSizes.push_back(size);
+
+        const auto add = [&](const ProcessBlockCase& c)
+        {
+            std::cerr << "processBlock " << (c.doublePrecision ? "double " : "float ") << c.design << ' '
+                      << c.numChannels << "ch " << c.blockSize << ' ' << typeNames[c.type] << (c.drift ? " drift" : "")
+                      << (c.dynamic ? " dynamic" : "") << std::endl;
+
+            const auto result = c.doublePrecision ? benchmarkProcessBlock<double>(options, c)
+                                                  : benchmarkProcessBlock<float>(options, c);
+
+            if (! result.isVoid())
+                results.add(result);
+        };
+
+        // The full grid, in the default configuration.
+        for (int numChannels : { 1, 2, 4, 8, 16 })
+            for (auto blockSize : blockSizes)
+                for (int type = 0; type < BiquadDesigner::numFilterTypes; ++type)
+                    for (bool drift : { false, true })
+                        add({ false, "bilinear", numChannels, blockSize, type, drift });
+
+        // Precision and design modes, on stereo bells.
+        for (auto blockSize : blockSizes)
+        {
+            for (bool drift : { false, true })
+            {
+                add({ true, "bilinear", 2, blockSize, BiquadDesigner::bell, drift });
+                add({ false, "table", 2, blockSize, BiquadDesigner::bell, drift });
+                add({ false, "matched", 2, blockSize, BiquadDesigner::bell, drift });
+                add({ true, "matched", 2, blockSize, BiquadDesigner::bell, drift });
+                add({ false, "svf", 2, blockSize, BiquadDesigner::bell, drift });
+                add({ true, "svf", 2, blockSize, BiquadDesigner::bell, drift });
+            }
+        }
+
+        // Dynamic bands, to set against the static stereo bells above.
+        for (auto blockSize : blockSizes)
+            for (bool drift : { false, true })
+                add({ false, "bilinear", 2, blockSize, BiquadDesigner::bell, drift, true });
+
+        return results;
+    }
+
+    //==============================================================================
+    EQBandBank<numBands> makeBank(int type)
+    {
+        EQBandBank<numBands> bank;
+
+        for (int band = 0; band < numBands; ++band)
+        {
+            bank.type[band] = type;
+            bank.gainCurrent[band] = 2.0f;
+            bank.freqStatic[band] = 60.0f * std::pow(4.0f, (float) band);
+            bank.freqLog2Current[band] = std::log2(bank.freqStatic[band]);
+            bank.Q[band] = 0.707f;
+        }
+
+        return bank;
+    }
+
+    /** Nanoseconds per band to redesign every band, for each design path. */
+    juce::var benchmarkCoefficientDesign(const Options& options)
+    {
+        juce::Array<juce::var> results;
+        const auto tables = CoefficientTables::getForSampleRate(sampleRate);
+        double sink = 0.0;
+
+        for (int type = 0; type < BiquadDesigner::numFilterTypes; ++type)
+        {
+            auto bank = makeBank(type);
+            BiquadCoefficients<float> floatCoefficients[numBands];
+            BiquadCoefficients<double> doubleCoefficients[numBands];
+            bool flip = false;
+
+            // Alternating between two frequencies stops anything being hoisted out of the loop.
+            const auto nudge = [&]
+            {
+                flip = ! flip;
+
+                for (int band = 0; band < numBands; ++band)
+                    bank.freqLog2Current[band] += flip ? 0.01f : -0.01f;
+
+                bank.needsUpdate = EQBandBank<numBands>::allBandsMask;
+                bank.freqDrifting = EQBandBank<numBands>::allBandsMask;
+            };
+
+            const auto add = [&](const char* name, double seconds)
+            {
+                std::cerr << "design " << name << ' ' << typeNames[type] << std::endl;
+                results.add(makeObject({ { "name", name }, { "type", typeNames[type] }, { "nsPerBand", seconds * 1.0e9 / numBands } }));
+            };
+
+            add("scalarExact", timePerCall(options, [&]
+            {
+                nudge();
+                for (int band = 0; band < numBands; ++band)
+                    BiquadDesigner::design(floatCoefficients[band], type, sampleRate, std::exp2(bank.freqLog2Current[band]),
+                                           bank.Q[band], bank.gainCurrent[band]);
+                sink += floatCoefficients[0].b0;
+            }));
+
+            add("simdHalfAngle", timePerCall(options, [&]
+            {
+                nudge();
+                bank.designCoefficients(sampleRate, floatCoefficients, nullptr);
+                sink += floatCoefficients[0].b0;
+            }));
+
+            add("table", timePerCall(options, [&]
+            {
+                nudge();
+                bank.designCoefficients(sampleRate, floatCoefficients, tables.get());
+                sink += floatCoefficients[0].b0;
+            }));
+
+            add("doubleExact", timePerCall(options, [&]
+            {
+                nudge();
+                bank.designCoefficients(sampleRate, doubleCoefficients);
+                sink += doubleCoefficients[0].b0;
+            }));
+
+            add("matched", timePerCall(options, [&]
+            {
+                nudge();
+                bank.designMatchedCoefficients(sampleRate, floatCoefficients);
+                sink += floatCoefficients[0].b0;
+            }));
+        }
+
+        std::cerr << "(checksum " << sink << ")" << std::endl;
+        return results;
+    }
+
+    /** UpdateBandParameters for every band, and one drift step of the whole bank. */
+    juce::var benchmarkControlUpdates(const Options& options)
+    {
+        std::cerr << "control updates" << std::endl;
+
+        EchidnaAudioProcessor processor;
+        configureBands(processor, BiquadDesigner::bell, true);
+        processor.setRateAndBufferSizeDetails(sampleRate, 512);
+        processor.prepareToPlay(sampleRate, 512);
+
+        const auto updateSeconds = timePerCall(options, [&]
+        {
+            for (int band = 0; band < numBands; ++band)
+                processor.UpdateBandParameters(band);
+        });
+
+        auto bank = makeBank(BiquadDesigner::bell);
+        bank.gainDrifting = bank.freqDrifting = EQBandBank<numBands>::allBandsMask;
+
+        for (int band = 0; band < numBands; ++band)
+        {
+            bank.gainSpeed[band] = bank.freqSpeed[band] = bank.gainDirection[band] = bank.freqDirection[band] = 1.0f;
+            bank.gainMin[band] = 0.5f;
+            bank.gainMax[band] = 2.0f;
+            bank.freqLog2Min[band] = std::log2(100.0f);
+            bank.freqLog2Max[band] = std::log2(2000.0f);
+        }
+
+        double driftTime = 0.0;
+
+        const auto driftSeconds = timePerCall(options, [&]
+        {
+            driftTime += 32.0 / sampleRate;
+            bank.advanceDrift(driftTime);
+        });
+
+        return makeObject({ { "updateBandParametersNsPerBand", updateSeconds * 1.0e9 / numBands },
+                            { "advanceDriftNsPerBand", driftSeconds * 1.0e9 / numBands } });
+    }
+
+    //==============================================================================
+    /** The fused cascade kernel against running each band over the block on its
+        own with the scalar reference biquad, one channel at a time, for each
+        band count the plug-in ships with. The cascade is also timed ramping its
+        coefficients across the whole block, between two designs a semitone apart.
+    */
+    template <int NumBands>
+    void benchmarkKernel(const Options& options, juce::Array<juce::var>& results)
+    {
+        constexpr int blockSize = 512;
+
+        for (int numChannels : { 1, 2, 4, 8, 12, 16 })
+        {
+            std::cerr << "kernel " << NumBands << " bands " << numChannels << "ch" << std::endl;
+
+            BiquadCascade<float, NumBands> cascade;
+            cascade.prepare(sampleRate);
+
+            BiquadState<float> referenceStates[NumBands][BiquadCascade<float, NumBands>::maxChannels];
+
+            // Two octaves apart from 60 Hz for five bands, closer together for more.
+            for (int band = 0; band < NumBands; ++band)
+                BiquadDesigner::design(cascade.coefficients[band], BiquadDesigner::bell, sampleRate,
+                                       60.0f * std::pow(256.0f, (float) band / (float) (NumBands - 1)), 0.707f, 2.0f);
+
+            const auto source = makeNoise<float>(numChannels, blockSize);
+            juce::AudioBuffer<float> work(numChannels, blockSize);
+
+            const auto cascadeSeconds = timePerCallWithFreshInput(options, source, work, [&]
+            {
+                cascade.process(work.getArrayOfWritePointers(), numChannels, 0, blockSize);
+            });
+
+            const auto referenceSeconds = timePerCallWithFreshInput(options, source, work, [&]
+            {
+                for (int channel = 0; channel < numChannels; ++channel)
+                {
+                    auto* data = work.getWritePointer(channel);
+
+                    for (int band = 0; band < NumBands; ++band)
+                        for (int i = 0; i < blockSize; ++i)
+                            data[i] = processBiquad(cascade.coefficients[band], referenceStates[band][channel], data[i]);
+                }
+            });
+
+            BiquadCoefficients<float> designs[2][NumBands];
+
+            for (int band = 0; band < NumBands; ++band)
+            {
+                designs[0][band] = cascade.coefficients[band];
+                BiquadDesigner::design(designs[1][band], BiquadDesigner::bell, sampleRate,
+                                       60.0f * std::pow(256.0f, (float) band / (float) (NumBands - 1)) * std::pow(2.0f, 1.0f / 12.0f), 0.707f, 2.0f);
+            }
+
+            int target = 0;
+
+            const auto rampedSeconds = timePerCallWithFreshInput(options, source, work, [&]
+            {
+                target ^= 1;
+                std::copy(std::begin(designs[target]), std::end(designs[target]), cascade.coefficients);
+                cascade.startRamp(blockSize);
+                cascade.process(work.getArrayOfWritePointers(), numChannels, 0, blockSize);
+            });
+
+            results.add(makeObject({ { "name", "cascade" }, { "bands", NumBands }, { "channels", numChannels },
+                                     { "nsPerSample", cascadeSeconds * 1.0e9 / blockSize } }));
+            results.add(makeObject({ { "name", "cascadeRamped" }, { "bands", NumBands }, { "channels", numChannels },
+                                     { "nsPerSample", rampedSeconds * 1.0e9 / blockSize } }));
+            results.add(makeObject({ { "name", "reference" }, { "bands", NumBands }, { "channels", numChannels },
+                                     { "nsPerSample", referenceSeconds * 1.0e9 / blockSize } }));
+        }
+    }
+
+    juce::var benchmarkKernels(const Options& options)
+    {
+        juce::Array<juce::var> results;
+        benchmarkKernel<3>(options, results);
+        benchmarkKernel<5>(options, results);
+        benchmarkKernel<8>(options, results);
+        return results;
+    }
+
+    /** Matched designs at the native rate against bilinear designs run at twice
+        the rate inside juce::dsp::Oversampling, the usual way of decramping.
+    */
+    juce::var benchmarkDecramping(const Options& options)
+    {
+        std::cerr << "decramping" << std::endl;
+
+        constexpr int numChannels = 2;
+        constexpr int blockSize = 512;
+
+        const auto source = makeNoise<float>(numChannels, blockSize);
+        juce::AudioBuffer<float> work(numChannels, blockSize);
+
+        BiquadCascade<float, numBands> matched;
+        matched.prepare(sampleRate);
+
+        BiquadCascade<float, numBands> oversampledBilinear;
+        oversampledBilinear.prepare(sampleRate * 2.0);
+
+        for (int band = 0; band < numBands; ++band)
+        {
+            const auto frequency = 60.0f * std::pow(4.0f, (float) band);
+            BiquadDesigner::designMatched(matched.coefficients[band], BiquadDesigner::bell, sampleRate, frequency, 0.707f, 2.0f);
+            BiquadDesigner::design(oversampledBilinear.coefficients[band], BiquadDesigner::bell, sampleRate * 2.0, frequency, 0.707f, 2.0f);
+        }
+
+        juce::dsp::Oversampling<float> oversampling((size_t) numChannels, 1, juce::dsp::Oversampling<float>::filterHalfBandPolyphaseIIR);
+        oversampling.initProcessing((size_t) blockSize);
+
+        const auto matchedSeconds = timePerCallWithFreshInput(options, source, work, [&]
+        {
+            matched.process(work.getArrayOfWritePointers(), numChannels, 0, blockSize);
+        });
+
+        const auto oversampledSeconds = timePerCallWithFreshInput(options, source, work, [&]
+        {
+            juce::dsp::AudioBlock<float> block(work);
+            auto upsampled = oversampling.processSamplesUp(block);
+
+            float* channels[numChannels];
+            for (int channel = 0; channel < numChannels; ++channel)
+                channels[channel] = upsampled.getChannelPointer((size_t) channel);
+
+            oversampledBilinear.process(channels, numChannels, 0, (int) upsampled.getNumSamples());
+            oversampling.processSamplesDown(block);
+        });
+
+        return makeObject({ { "channels", numChannels },
+                            { "blockSize", blockSize },
+                            { "matchedNsPerSample", matchedSeconds * 1.0e9 / blockSize },
+                            { "bilinear2xOversampledNsPerSample", oversampledSeconds * 1.0e9 / blockSize },
+                            { "oversamplingLatencySamples", (double) oversampling.getLatencyInSamples() } });
+    }
+
+    //==============================================================================
+    /** What an instance costs to keep around: the size of the processor and the
+        parts the audio thread works in, the heap it takes to construct and to
+        prepare, and how long a large session spends creating instances.
+    */
+    juce::var measureMemory(const Options& options)
+    {
+        std::cerr << "memory" << std::endl;
+
+        struct Usage
+        {
+            juce::int64 bytes = HeapCounter::liveBytes.load(), allocations = HeapCounter::numAllocations.load();
+            juce::int64 mallocBytes = HeapCounter::getMallocBytes();
+
+            // "bytes" only sees operator new; "mallocBytes" is everything the C
+            // heap holds, new included, rounded up to its own block sizes.
+            juce::var since(const Usage& start) const
+            {
+                return makeObject({ { "bytes", bytes - start.bytes }, { "allocations", allocations - start.allocations },
+                                    { "mallocBytes", mallocBytes < 0 ? juce::var() : juce::var(mallocBytes - start.mallocBytes) } });
+            }
+        };
+
+        const Usage beforeConstruction;
+        auto processor = std::make_unique<EchidnaAudioProcessor>();
+        const Usage afterConstruction;
+
+        processor->prepareToPlay(sampleRate, 512);
+        const Usage afterPrepare;
+
+        processor->getAnalyser().setEnabled(true);
+        const Usage afterAnalyser;
+        processor->getAnalyser().setEnabled(false);
+
+        // On the message thread, so the engine is set up before this returns.
+        auto* linearPhase = processor->getValueTreeState().getParameter("LINEAR_PHASE");
+        linearPhase->setValueNotifyingHost(1.0f);
+        const Usage afterLinearPhase;
+        linearPhase->setValueNotifyingHost(0.0f);
+
+        processor.reset();
+
+        const int numInstances = options.quick ? 20 : 200;
+        std::vector<std::unique_ptr<EchidnaAudioProcessor>> instances;
+        instances.reserve((size_t) numInstances);
+
+        const auto start = std::chrono::steady_clock::now();
+
+        for (int i = 0; i < numInstances; ++i)
+        {
+            instances.push_back(std::make_unique<EchidnaAudioProcessor>());
+            instances.back()->prepareToPlay(sampleRate, 512);
+        }
+
+        const auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        instances.clear();
+
+        return makeObject({ { "processorBytes", (int) sizeof(EchidnaAudioProcessor) },
+                            { "bandBankBytes", (int) sizeof(EQBandBank<numBands>) },
+                            { "floatCascadeBytes", (int) sizeof(BiquadCascade<float, numBands>) },
+                            { "floatSvfBytes", (int) sizeof(SvfCascade<float, numBands>) },
+                            { "detectorBytes", (int) sizeof(DynamicsDetector<numBands>) },
+                            { "construction", afterConstruction.since(beforeConstruction) },
+                            { "prepareToPlay", afterPrepare.since(afterConstruction) },
+                            { "enableAnalyser", afterAnalyser.since(afterPrepare) },
+                            { "enableLinearPhase", afterLinearPhase.since(afterAnalyser) },
+                            { "instances", numInstances },
+                            { "msPerInstance", seconds * 1.0e3 / numInstances } });
+    }
+}
+
+//==============================================================================
+int main(int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+    juce::ArgumentList args(argc, argv);
+
+    if (args.containsOption("--help|-h"))
+    {
+        std::cout << "Usage: EchidnaBenchmark [--output=<file.json>] [--quick] [--seconds=<per round>]\n"
+                     "\n"
+                     "Writes the results as JSON to the file, or to stdout. Progress goes to stderr." << std::endl;
+        return 0;
+    }
+
+    Options options;
+    options.quick = args.containsOption("--quick");
+
+    if (options.quick)
+        options.secondsPerRound = 0.005;
+
+    if (args.getValueForOption("--seconds").getDoubleValue() > 0.0)
+        options.secondsPerRound = args.getValueForOption("--seconds").getDoubleValue();
+
+    const auto results = makeObject({ { "cpu", juce::SystemStats::getCpuModel() },
+                                      { "os", juce::SystemStats::getOperatingSystemName() },
+                                      { "simdLanes", (int) juce::dsp::SIMDRegister<float>::SIMDNumElements },
+                                      { "sampleRate", sampleRate },
+                                      { "time", juce::Time::getCurrentTime().toISO8601(true) },
+                                      { "processBlock", benchmarkProcessBlocks(options) },
+                                      { "coefficientDesign", benchmarkCoefficientDesign(options) },
+                                      { "controlUpdates", benchmarkControlUpdates(options) },
+                                      { "kernel", benchmarkKernels(options) },
+                                      { "decramping", benchmarkDecramping(options) },
+                                      { "memory", measureMemory(options) } });
+
+    const auto json = juce::JSON::toString(results);
+    const auto outputPath = args.getValueForOption("--output");
+
+    if (outputPath.isEmpty())
+    {
+        std::cout << json << std::endl;
+    }
+    else if (! juce::File::getCurrentWorkingDirectory().getChildFile(outputPath).replaceWithText(json))
+    {
+        std::cerr << "Can't write " << outputPath << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,1784 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+    Console test runner for the DSP building blocks and the processor.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../../Source/PluginProcessor.h"
+#include "../../../Source/ResponseCurve.h"
+
+//==============================================================================
+namespace
+{
+    constexpr double sampleRate = 48000.0;
+    const char* const typeNames[] = { "Bell", "Low shelf", "High shelf", "Low pass", "High pass" };
+
+    /** A reproducible stream of white noise in [-0.5, 0.5). */
+    struct Noise
+    {
+        juce::uint32 seed = 1;
+
+        float next()
+        {
+            seed = seed * 1664525u + 1013904223u;
+            return (float) (seed >> 8) / 16777216.0f - 0.5f;
+        }
+    };
+}
+
+//==============================================================================
+class BiquadCascadeTest  : public juce::UnitTest
+{
+public:
+    BiquadCascadeTest() : juce::UnitTest("Biquad cascade", "Echidna") {}
+
+    void runTest() override
+    {
+        beginTest("The fused kernel matches stage-by-stage filtering for every number of active stages, in float");
+        checkEveryActiveCount<float>(1.0e-5);
+
+        beginTest("The fused kernel matches stage-by-stage filtering for every number of active stages, in double");
+        checkEveryActiveCount<double>(1.0e-12);
+
+        struct Setting { int type; float frequency, Q, gain; };
+        const Setting settings[] = { { BiquadDesigner::bell, 30.0f, 10.0f, 4.0f },
+                                     { BiquadDesigner::bell, 2000.0f, 2.0f, 0.25f },
+                                     { BiquadDesigner::lowPass, 100.0f, 5.0f, 1.0f },
+                                     { BiquadDesigner::highShelf, 8000.0f, 0.7071f, 0.25f } };
+
+        const auto makeBank = [](const Setting& setting)
+        {
+            EQBandBank<1> bank;
+            bank.type[0] = setting.type;
+            bank.prevGain[0] = setting.gain;
+            bank.freqStatic[0] = setting.frequency;
+            bank.Q[0] = setting.Q;
+            return bank;
+        };
+
+        beginTest("An impulse has rung down by the tail a band reports, and not long before");
+        {
+            constexpr double decayDecibels = 120.0;
+
+            for (const auto& setting : settings)
+            {
+                const auto tailSamples = makeBank(setting).getTailSamples(0, sampleRate, false, decayDecibels);
+
+                BiquadCoefficients<double> c;
+                BiquadDesigner::design(c, setting.type, sampleRate, (double) setting.frequency, (double) setting.Q, (double) setting.gain);
+
+                // The ringing alone, without the impulse passed straight through.
+                BiquadState<double> state;
+                std::vector<double> ringing;
+                ringing.push_back(processBiquad(c, state, 1.0) - c.b0);
+
+                while ((double) ringing.size() < 2.0 * tailSamples + 64.0)
+                    ringing.push_back(processBiquad(c, state, 0.0));
+
+                const auto threshold = juce::Decibels::decibelsToGain(-decayDecibels) * *std::max_element(ringing.begin(), ringing.end(),
+                                           [](double a, double b) { return std::abs(a) < std::abs(b); });
+                const auto lastAbove = std::distance(std::find_if(ringing.rbegin(), ringing.rend(),
+                                                                  [threshold](double y) { return std::abs(y) > std::abs(threshold); }),
+                                                     ringing.rend());
+
+                const auto where = juce::String(typeNames[setting.type]) + " at " + juce::String(setting.frequency) + " Hz";
+                // The pole radius only sets the envelope; ringing that peaks a
+                // few samples in can run a little past it.
+                expectLessOrEqual((double) lastAbove, 1.1 * tailSamples, where);
+                expectGreaterThan((double) lastAbove, 0.5 * tailSamples, where);
+            }
+        }
+
+        beginTest("The delay lines count as silent once they have rung out, and not before");
+        {
+            BiquadCascade<float, std::size(settings)> cascade;
+            cascade.prepare(sampleRate);
+            double tailSamples = 0.0;
+
+            for (size_t i = 0; i < std::size(settings); ++i)
+            {
+                const auto& setting = settings[i];
+                BiquadDesigner::design(cascade.coefficients[i], setting.type, sampleRate, setting.frequency, setting.Q, setting.gain);
+
+                // In series, the tails add up. Noise this loud needs a few
+                // more decibels of decay than a unit impulse.
+                tailSamples += makeBank(setting).getTailSamples(0, sampleRate, false, 160.0);
+            }
+
+            cascade.snapToTargets();
+            expect(cascade.isSilent(1.0e-7f));
+
+            std::vector<float> block(64);
+            auto* channelData = block.data();
+            Noise noise;
+
+            for (auto& sample : block)
+                sample = noise.next();
+
+            cascade.process(&channelData, 1, 0, (int) block.size());
+            expect(! cascade.isSilent(1.0e-7f));
+
+            int silentAfter = 0;
+
+            for (; ! cascade.isSilent(1.0e-7f) && silentAfter < 10 * (int) tailSamples; silentAfter += (int) block.size())
+            {
+                std::fill(block.begin(), block.end(), 0.0f);
+                cascade.process(&channelData, 1, 0, (int) block.size());
+            }
+
+            expectLessOrEqual((double) silentAfter, tailSamples + (double) block.size());
+
+            // Only the first channels were ever fed.
+            expect(cascade.isSilent(1.0e-7f, 1));
+        }
+    }
+
+private:
+    static constexpr int numStages = 8;
+
+    /** Runs count stages, picked out of order so the kernel sees gaps, over
+        enough channel counts to cover one group, a pair of groups and an odd
+        one left over.
+    */
+    template <typename SampleType>
+    void checkEveryActiveCount(double tolerance)
+    {
+        using Cascade = BiquadCascade<SampleType, numStages>;
+        constexpr int length = 1000;
+
+        BiquadCoefficients<SampleType> designs[numStages];
+
+        for (int i = 0; i < numStages; ++i)
+            BiquadDesigner::design(designs[i], i % 5, sampleRate, (SampleType) (40.0 * std::pow(2.0, i)),
+                                   (SampleType) (0.7 + 0.4 * i), (SampleType) (i % 2 == 0 ? 1.8 : 0.6));
+
+        for (int count = 0; count <= numStages; ++count)
+        {
+            bool isActive[numStages] {};
+
+            for (int j = 0; j < count; ++j)
+                isActive[(j * 3) % numStages] = true;
+
+            for (const auto numChannels : { 1, Cascade::numLanes + 1, 2 * Cascade::numLanes + 1, Cascade::maxChannels })
+            {
+                Cascade cascade;
+                cascade.prepare(sampleRate);
+                std::copy(std::begin(designs), std::end(designs), cascade.coefficients);
+                cascade.snapToTargets();
+
+                std::vector<std::vector<SampleType>> signals((size_t) numChannels, std::vector<SampleType>(length));
+                std::vector<SampleType*> channelData;
+
+                for (auto& signal : signals)
+                    channelData.push_back(signal.data());
+
+                // Let the switched-off stages fade right out before comparing.
+                for (int i = 0; i < numStages; ++i)
+                    cascade.setStageEnabled(i, isActive[i]);
+
+                cascade.process(channelData.data(), numChannels, 0, length);
+                cascade.reset();
+
+                Noise noise;
+
+                for (auto& signal : signals)
+                    for (auto& sample : signal)
+                        sample = (SampleType) noise.next();
+
+                auto expected = signals;
+
+                for (auto& signal : expected)
+                {
+                    BiquadState<SampleType> states[numStages];
+
+                    for (auto& sample : signal)
+                        for (int i = 0; i < numStages; ++i)
+                            if (isActive[i])
+                                sample = processBiquad(designs[i], states[i], sample);
+                }
+
+                // Uneven slices, so the delay lines are carried between them.
+                cascade.process(channelData.data(), numChannels, 0, 1);
+                cascade.process(channelData.data(), numChannels, 1, 37);
+                cascade.process(channelData.data(), numChannels, 38, length - 38);
+
+                double difference = 0.0;
+
+                for (size_t channel = 0; channel < signals.size(); ++channel)
+                    for (size_t n = 0; n < (size_t) length; ++n)
+                        difference = juce::jmax(difference, (double) std::abs(signals[channel][n] - expected[channel][n]));
+
+                expectLessThan(difference, tolerance, juce::String(count) + " stages on " + juce::String(numChannels) + " channels");
+            }
+        }
+    }
+};
+
+static BiquadCascadeTest biquadCascadeTest;
+
+//==============================================================================
+class BiquadRampTest  : public juce::UnitTest
+{
+public:
+    BiquadRampTest() : juce::UnitTest("Biquad coefficient ramp", "Echidna") {}
+
+    void runTest() override
+    {
+        constexpr int numStages = 5;
+        constexpr int numChannels = 3;
+        constexpr int rampLength = 64;
+
+        BiquadCoefficients<double> from[numStages], to[numStages];
+
+        for (int i = 0; i < numStages; ++i)
+        {
+            BiquadDesigner::design(from[i], BiquadDesigner::bell, sampleRate, 100.0 * (i + 1), 1.0, 2.0);
+            BiquadDesigner::design(to[i], BiquadDesigner::bell, sampleRate, 105.0 * (i + 1), 1.0, 2.2);
+        }
+
+        // The same move, worked out one sample at a time in scalar code from
+        // zeroed delay lines, starting rampOffset samples into the ramp.
+        const auto runReference = [&](std::vector<double>& signal, int rampOffset)
+        {
+            BiquadState<double> states[numStages];
+
+            for (size_t n = 0; n < signal.size(); ++n)
+            {
+                const auto t = juce::jmin(1.0, (double) (rampOffset + (int) n + 1) / rampLength);
+                auto x = signal[n];
+
+                for (int i = 0; i < numStages; ++i)
+                {
+                    const auto& a = from[i];
+                    const auto& b = to[i];
+                    const BiquadCoefficients<double> k { a.b0 + (b.b0 - a.b0) * t, a.b1 + (b.b1 - a.b1) * t, a.b2 + (b.b2 - a.b2) * t,
+                                                         a.a1 + (b.a1 - a.a1) * t, a.a2 + (b.a2 - a.a2) * t };
+                    x = processBiquad(t < 1.0 ? k : b, states[i], x);
+                }
+
+                signal[n] = x;
+            }
+        };
+
+        const auto makeSignals = [](int length)
+        {
+            std::vector<std::vector<double>> signals(numChannels);
+
+            for (int channel = 0; channel < numChannels; ++channel)
+                for (int n = 0; n < length; ++n)
+                    signals[(size_t) channel].push_back(std::sin(0.01 * n * (channel + 1)));
+
+            return signals;
+        };
+
+        const auto startCascade = [&](BiquadCascade<double, numStages>& cascade)
+        {
+            cascade.prepare(sampleRate);
+            std::copy(std::begin(from), std::end(from), cascade.coefficients);
+            cascade.snapToTargets();
+            std::copy(std::begin(to), std::end(to), cascade.coefficients);
+            cascade.startRamp(rampLength);
+        };
+
+        const auto maxDifference = [](const std::vector<std::vector<double>>& a, const std::vector<std::vector<double>>& b)
+        {
+            double difference = 0.0;
+
+            for (size_t channel = 0; channel < a.size(); ++channel)
+                for (size_t n = 0; n < a[channel].size(); ++n)
+                    difference = juce::jmax(difference, std::abs(a[channel][n] - b[channel][n]));
+
+            return difference;
+        };
+
+        beginTest("A small move is interpolated sample by sample and lands on the targets");
+        {
+            BiquadCascade<double, numStages> cascade;
+            startCascade(cascade);
+
+            auto signals = makeSignals(2 * rampLength);
+            auto expected = signals;
+
+            for (auto& signal : expected)
+                runReference(signal, 0);
+
+            // Split mid-ramp, the way a slice boundary would.
+            double* channelData[numChannels] = { signals[0].data(), signals[1].data(), signals[2].data() };
+            cascade.process(channelData, numChannels, 0, 30);
+            cascade.process(channelData, numChannels, 30, 2 * rampLength - 30);
+
+            expectLessThan(maxDifference(signals, expected), 1.0e-9);
+        }
+
+        beginTest("A skipped slice moves the ramp on");
+        {
+            constexpr int skipped = 24;
+
+            BiquadCascade<double, numStages> cascade;
+            startCascade(cascade);
+            cascade.reset();
+            cascade.skip(skipped);
+
+            auto signals = makeSignals(rampLength);
+            auto expected = signals;
+
+            for (auto& signal : expected)
+                runReference(signal, skipped);
+
+            double* channelData[numChannels] = { signals[0].data(), signals[1].data(), signals[2].data() };
+            cascade.process(channelData, numChannels, 0, rampLength);
+
+            expectLessThan(maxDifference(signals, expected), 1.0e-9);
+        }
+
+        beginTest("A jump across the whole spectrum arrives within maxRampSamples");
+        {
+            constexpr int tickLength = 32;
+            constexpr int limit = BiquadCascade<float, 1>::maxRampSamples;
+            const double moves[][2] = { { 20.0, 20000.0 }, { 20000.0, 20.0 }, { 1000.0, 20.0 }, { 20.0, 2000.0 } };
+
+            for (const auto type : { BiquadDesigner::bell, BiquadDesigner::lowPass })
+            {
+                for (const auto& move : moves)
+                {
+                    BiquadCascade<float, 1> cascade;
+                    BiquadDesigner::design(cascade.coefficients[0], type, sampleRate, (float) move[0], 10.0f, 4.0f);
+                    cascade.prepare(sampleRate);
+
+                    std::vector<float> block(tickLength);
+                    Noise noise;
+                    int elapsed = 0;
+
+                    // Asked for again every tick, the way the processor does.
+                    for (; elapsed < 4 * limit; elapsed += tickLength)
+                    {
+                        BiquadDesigner::design(cascade.coefficients[0], type, sampleRate, (float) move[1], 10.0f, 4.0f);
+                        cascade.startRamp(tickLength);
+
+                        for (auto& sample : block)
+                            sample = noise.next();
+
+                        auto* channelData = block.data();
+                        cascade.process(&channelData, 1, 0, tickLength);
+
+                        if (! cascade.isRamping())
+                            break;
+                    }
+
+                    expectLessThan(elapsed, limit, juce::String(typeNames[type]) + " from " + juce::String(move[0]) + " Hz to "
+                                                       + juce::String(move[1]) + " Hz");
+                }
+            }
+        }
+
+        // Designs jumping across the spectrum, between +-20 dB and Q 10. A
+        // direct form switched straight to each design pumps energy into its
+        // delay lines faster than it decays and blows up. Ramped, the output
+        // has to stay within what the loudest design could do to the noise on
+        // its own, both when the designs change every tick and never arrive,
+        // and when each is held just long enough to be reached.
+        beginTest("Extreme modulation stays bounded when ramped");
+        {
+            constexpr int tickLength = 8;
+            constexpr int holdTicks = BiquadCascade<float, numStages>::maxRampSamples / tickLength;
+            const auto loudestDesign = 0.5f * std::pow(10.0f, (float) numStages);
+
+            const auto peakWith = [this](bool ramp, int ticksPerDesign)
+            {
+                BiquadCascade<float, numStages> cascade;
+                cascade.prepare(sampleRate);
+
+                Noise noise;
+                std::vector<float> block(tickLength);
+                float peak = 0.0f;
+                int missed = 0;
+
+                for (int tick = 0; tick < (int) sampleRate * 20 / tickLength; ++tick)
+                {
+                    const auto design = tick / ticksPerDesign;
+
+                    if (tick > 0 && tick % ticksPerDesign == 0 && cascade.isRamping())
+                        ++missed;
+
+                    for (int i = 0; i < numStages; ++i)
+                    {
+                        const auto frequency = 20.0 * std::pow(1000.0, ((design * 7 + i * 13) % 100) / 100.0);
+                        BiquadDesigner::design(cascade.coefficients[i], i % 5, sampleRate, (float) frequency,
+                                               10.0f, (design % 2) != 0 ? 10.0f : 0.1f);
+                    }
+
+                    if (ramp && tick > 0)
+                        cascade.startRamp(tickLength);
+                    else
+                        cascade.snapToTargets();
+
+                    for (auto& sample : block)
+                        sample = noise.next();
+
+                    auto* channelData = block.data();
+                    cascade.process(&channelData, 1, 0, tickLength);
+
+                    for (auto sample : block)
+                        peak = std::isfinite(sample) ? juce::jmax(peak, std::abs(sample)) : std::numeric_limits<float>::max();
+                }
+
+                if (ticksPerDesign > 1)
+                    expectEquals(missed, 0, "held designs weren't reached");
+
+                return peak;
+            };
+
+            expectGreaterThan(peakWith(false, 1), 1.0e6f, "the stress test no longer stresses a direct form");
+            expectLessThan(peakWith(true, 1), loudestDesign);
+            expectLessThan(peakWith(true, holdTicks), loudestDesign);
+        }
+    }
+};
+
+static BiquadRampTest biquadRampTest;
+
+//==============================================================================
+class MatchedDesignTest  : public juce::UnitTest
+{
+public:
+    MatchedDesignTest() : juce::UnitTest("Matched biquad design", "Echidna") {}
+
+    void runTest() override
+    {
+        using namespace BiquadDesigner;
+
+        const auto expectMagnitude = [this](double actual, double expected, const juce::String& where)
+        {
+            expectWithinAbsoluteError(actual, expected, 1.0e-6 + 1.0e-4 * expected, where);
+        };
+
+        for (const auto type : { bell, lowShelf, highShelf, lowPass, highPass })
+        {
+            beginTest(juce::String(typeNames[type]) + " matches its analogue prototype at DC, the band and Nyquist");
+
+            for (const auto frequency : { 40.0, 1000.0, 8000.0, 16000.0 })
+            {
+                for (const auto Q : { 0.5, 0.7071, 4.0 })
+                {
+                    for (const auto gain : { 0.25, 4.0 })
+                    {
+                        BiquadCoefficients<double> c;
+                        designMatched(c, type, sampleRate, frequency, Q, gain);
+
+                        const auto prototype = getAnaloguePrototype(type, Q, gain);
+                        const auto analogue = [&](double x) { return std::sqrt(prototype.getMagnitudeSquared(x)); };
+                        const auto where = juce::String(frequency) + " Hz, Q " + juce::String(Q) + ", gain " + juce::String(gain);
+
+                        expectLessThan(getPoleRadius(c), 1.0, "unstable at " + where);
+                        expectMagnitude(getMagnitudeForFrequency(c, 0.5 * sampleRate, sampleRate), analogue(0.5 * sampleRate / frequency),
+                                        "Nyquist at " + where);
+
+                        // The high pass keeps its double zero at DC, so it is
+                        // only fitted at Nyquist.
+                        if (type != highPass)
+                        {
+                            expectMagnitude(getMagnitudeForFrequency(c, 0.0, sampleRate), analogue(0.0), "DC at " + where);
+                            expectMagnitude(getMagnitudeForFrequency(c, frequency, sampleRate), analogue(1.0), "band at " + where);
+                        }
+                    }
+                }
+            }
+        }
+    }
+};
+
+static MatchedDesignTest matchedDesignTest;
+
+//==============================================================================
+class CoefficientTableTest  : public juce::UnitTest
+{
+public:
+    CoefficientTableTest() : juce::UnitTest("Table-driven design", "Echidna") {}
+
+    void runTest() override
+    {
+        using namespace BiquadDesigner;
+
+        // The sweep and tolerances documented in CoefficientTables.h: the
+        // response above 1 kHz, and what the tables add to the exact float
+        // design's own error below it.
+        struct Rate { double sampleRate, aboveTolerance, belowTolerance; };
+        const Rate rates[] = { { 44100.0, 0.005, 0.04 }, { 48000.0, 0.005, 0.04 }, { 96000.0, 0.01, 0.25 }, { 192000.0, 0.03, 0.5 } };
+
+        for (const auto type : { bell, lowShelf, highShelf, lowPass, highPass })
+        {
+            beginTest(juce::String(typeNames[type]) + " from the tables matches the double-precision design");
+
+            for (const auto& rate : rates)
+            {
+                const auto tables = CoefficientTables::getForSampleRate(rate.sampleRate);
+                EQBandBank<1> bank;
+                bank.type[0] = type;
+
+                double worstCoefficient = 0.0, worstAbove = 0.0, worstBelow = 0.0;
+
+                const auto decibelsAt = [&rate](const auto& c, double frequency)
+                {
+                    return juce::Decibels::gainToDecibels(getMagnitudeForFrequency(c, frequency, rate.sampleRate), -200.0);
+                };
+
+                for (int f = 0; f <= 30; ++f)
+                {
+                    const auto frequency = 20.0 * std::pow(1000.0, f / 30.0);
+
+                    for (const auto Q : { 0.1, 0.3, 0.7071, 2.0, 10.0 })
+                    {
+                        for (const auto gain : { 0.1, 0.5, 1.0, 2.0, 10.0 })
+                        {
+                            bank.freqLog2Current[0] = (float) std::log2(frequency);
+                            bank.Q[0] = (float) Q;
+                            bank.gainCurrent[0] = (float) gain;
+
+                            BiquadCoefficients<float> table, exactFloat;
+                            bank.needsUpdate = 1;
+                            bank.designCoefficients(rate.sampleRate, &table, tables.get());
+                            bank.needsUpdate = 1;
+                            bank.designCoefficients(rate.sampleRate, &exactFloat, nullptr);
+
+                            // The double path, from the same float parameters the bank holds.
+                            BiquadCoefficients<double> reference;
+                            design(reference, type, rate.sampleRate, (double) std::exp2(bank.freqLog2Current[0]),
+                                   (double) bank.Q[0], (double) bank.gainCurrent[0]);
+
+                            const auto largestB = std::max({ std::abs(reference.b0), std::abs(reference.b1), std::abs(reference.b2) });
+
+                            worstCoefficient = std::max({ worstCoefficient,
+                                                          std::abs(table.b0 - reference.b0) / largestB,
+                                                          std::abs(table.b1 - reference.b1) / largestB,
+                                                          std::abs(table.b2 - reference.b2) / largestB,
+                                                          std::abs(table.a1 - reference.a1),
+                                                          std::abs(table.a2 - reference.a2) });
+
+                            for (int probe = 0; probe <= 40; ++probe)
+                            {
+                                const auto probeFrequency = 20.0 * std::pow(1000.0, probe / 40.0);
+                                const auto expected = decibelsAt(reference, probeFrequency);
+
+                                // Deep in a pass filter's stop band only the shape matters.
+                                if (expected < -60.0)
+                                    continue;
+
+                                const auto error = std::abs(decibelsAt(table, probeFrequency) - expected);
+
+                                if (frequency >= 1000.0)
+                                    worstAbove = juce::jmax(worstAbove, error);
+                                else
+                                    worstBelow = juce::jmax(worstBelow, error - std::abs(decibelsAt(exactFloat, probeFrequency) - expected));
+                            }
+                        }
+                    }
+                }
+
+                const auto where = juce::String(rate.sampleRate) + " Hz";
+                expectLessThan(worstCoefficient, 8.0e-5, "coefficients at " + where);
+                expectLessThan(worstAbove, rate.aboveTolerance, "response above 1 kHz at " + where);
+                expectLessThan(worstBelow, rate.belowTolerance, "response below 1 kHz at " + where);
+            }
+        }
+    }
+};
+
+static CoefficientTableTest coefficientTableTest;
+
+//==============================================================================
+class SvfTest  : public juce::UnitTest
+{
+public:
+    SvfTest() : juce::UnitTest("State-variable filters", "Echidna") {}
+
+    void runTest() override
+    {
+        using namespace BiquadDesigner;
+
+        for (const auto type : { bell, lowShelf, highShelf, lowPass, highPass })
+        {
+            beginTest(juce::String(typeNames[type]) + " has the magnitude of the bilinear design");
+
+            for (const auto frequency : { 100.0, 1000.0, 12000.0 })
+            {
+                for (const auto Q : { 0.7, 4.0 })
+                {
+                    for (const auto gain : { 0.25, 4.0 })
+                    {
+                        BiquadCoefficients<double> biquad;
+                        design(biquad, type, sampleRate, frequency, Q, gain);
+
+                        SvfCascade<double, 1> svf;
+                        SvfDesigner::design(svf.targets[0], type, sampleRate, frequency, Q, gain);
+                        svf.prepare();
+
+                        // Long enough for the slowest of these to ring down completely.
+                        std::vector<double> impulse(1 << 16, 0.0);
+                        impulse[0] = 1.0;
+                        auto* channelData = impulse.data();
+                        svf.process(&channelData, 1, 0, (int) impulse.size());
+
+                        double worst = 0.0;
+
+                        for (const auto probe : { 20.0, 0.5 * frequency, frequency, 2.0 * frequency, 20000.0 })
+                        {
+                            std::complex<double> sum;
+                            const auto omega = juce::MathConstants<double>::twoPi * probe / sampleRate;
+
+                            for (size_t n = 0; n < impulse.size(); ++n)
+                                sum += impulse[n] * std::polar(1.0, -omega * (double) n);
+
+                            const auto expected = getMagnitudeForFrequency(biquad, probe, sampleRate);
+
+                            // Deep in a pass filter's stop band there are too few digits left to compare.
+                            if (expected > 1.0e-4)
+                                worst = juce::jmax(worst, std::abs(juce::Decibels::gainToDecibels(std::abs(sum), -300.0)
+                                                                   - juce::Decibels::gainToDecibels(expected, -300.0)));
+                        }
+
+                        expectLessThan(worst, 1.0e-9, juce::String(frequency) + " Hz, Q " + juce::String(Q) + ", gain " + juce::String(gain));
+                    }
+                }
+            }
+        }
+
+        // The biquad ramp's stress test, without the speed limit the biquads
+        // need: every design is reached within its tick.
+        beginTest("Extreme modulation stays bounded");
+        {
+            constexpr int numStages = 5;
+            constexpr int tickLength = 8;
+
+            SvfCascade<float, numStages> svf;
+            svf.prepare();
+
+            Noise noise;
+            std::vector<float> block(tickLength);
+            float peak = 0.0f;
+
+            for (int tick = 0; tick < (int) sampleRate * 20 / tickLength; ++tick)
+            {
+                for (int i = 0; i < numStages; ++i)
+                {
+                    const auto frequency = 20.0 * std::pow(1000.0, ((tick * 7 + i * 13) % 100) / 100.0);
+                    SvfDesigner::design(svf.targets[i], i % 5, sampleRate, (float) frequency, 10.0f, (tick % 2) != 0 ? 10.0f : 0.1f);
+                }
+
+                if (tick > 0)
+                    svf.startRamp(tickLength);
+                else
+                    svf.snapToTargets();
+
+                for (auto& sample : block)
+                    sample = noise.next();
+
+                auto* channelData = block.data();
+                svf.process(&channelData, 1, 0, tickLength);
+
+                for (auto sample : block)
+                    peak = std::isfinite(sample) ? juce::jmax(peak, std::abs(sample)) : std::numeric_limits<float>::max();
+            }
+
+            expectLessThan(peak, 0.5f * std::pow(10.0f, (float) numStages));
+        }
+    }
+};
+
+static SvfTest svfTest;
+
+//==============================================================================
+class LinearPhaseTest  : public juce::UnitTest
+{
+public:
+    LinearPhaseTest() : juce::UnitTest("Linear-phase engine", "Echidna") {}
+
+    void runTest() override
+    {
+        using namespace BiquadDesigner;
+
+        LinearPhaseEngine engine;
+        engine.prepare(sampleRate, 1);
+
+        beginTest("Nothing is set up until the engine is enabled");
+        expect(! engine.isReady());
+        engine.setEnabled(true);
+        expect(engine.isReady());
+
+        const auto latency = engine.getLatencySamples();
+        const auto kernelSize = LinearPhaseEngine::getKernelSize(sampleRate);
+        expectEquals(latency, kernelSize / 2 + LinearPhaseEngine::partitionSize);
+
+        BiquadCoefficients<double> stages[2];
+        design(stages[0], bell, sampleRate, 1000.0, 1.0, 4.0);
+        design(stages[1], highShelf, sampleRate, 6000.0, 0.7, 0.5);
+
+        auto& request = engine.getKernelRequest();
+        request.numStages = 2;
+        std::copy(std::begin(stages), std::end(stages), request.coefficients);
+        engine.designKernelNow();
+
+        // Let the new kernel fade all the way in, then start from silence.
+        std::vector<float> response((size_t) (2 * kernelSize), 0.0f);
+        auto* channelData = response.data();
+        engine.process(&channelData, 1, 0, (int) response.size());
+        engine.reset();
+
+        std::fill(response.begin(), response.end(), 0.0f);
+        response[0] = 1.0f;
+        engine.process(&channelData, 1, 0, (int) response.size());
+
+        beginTest("An impulse comes out symmetric about the reported latency");
+        {
+            const auto peak = std::max_element(response.begin(), response.end(), [](float a, float b) { return std::abs(a) < std::abs(b); });
+            expectEquals((int) std::distance(response.begin(), peak), latency);
+
+            float asymmetry = 0.0f;
+
+            for (int n = 1; n < kernelSize / 2; ++n)
+                asymmetry = juce::jmax(asymmetry, std::abs(response[(size_t) (latency + n)] - response[(size_t) (latency - n)]));
+
+            expectLessThan(asymmetry, 1.0e-5f);
+        }
+
+        beginTest("Its magnitude is the minimum-phase cascade's");
+        {
+            for (const auto probe : { 100.0, 500.0, 1000.0, 2000.0, 6000.0, 15000.0 })
+            {
+                std::complex<double> sum;
+                const auto omega = juce::MathConstants<double>::twoPi * probe / sampleRate;
+
+                for (size_t n = 0; n < response.size(); ++n)
+                    sum += (double) response[n] * std::polar(1.0, -omega * (double) n);
+
+                const auto expected = getMagnitudeForFrequency(stages[0], probe, sampleRate)
+                                    * getMagnitudeForFrequency(stages[1], probe, sampleRate);
+
+                expectWithinAbsoluteError(juce::Decibels::gainToDecibels(std::abs(sum)), juce::Decibels::gainToDecibels(expected), 0.05,
+                                          juce::String(probe) + " Hz");
+            }
+        }
+
+        engine.release();
+    }
+};
+
+static LinearPhaseTest linearPhaseTest;
+
+//==============================================================================
+class DriftTest  : public juce::UnitTest
+{
+public:
+    DriftTest() : juce::UnitTest("Drift", "Echidna") {}
+
+    void runTest() override
+    {
+        constexpr int tickLength = 32;
+        constexpr double tickSeconds = tickLength / sampleRate;
+        const double speeds[] = { 0.37, -0.05, 2.9, 0.0001, -1.3 };
+
+        // Phases wrap, so 0.9999999 and 0.0000001 are next to each other.
+        const auto phaseDistance = [](double a, double b)
+        {
+            const auto d = a - b;
+            return std::abs(d - std::round(d));
+        };
+
+        beginTest("Closed form matches a running sum, tick by tick, through speed changes");
+        {
+            DriftLfo lfo;
+            lfo.setPosition(0.3);
+
+            auto sum = lfo.getPhase();
+            double worst = 0.0;
+            const int ticksPerSpeed = (int) (10.0 / tickSeconds);
+
+            for (int tick = 1; tick <= 60 * ticksPerSpeed; ++tick)
+            {
+                const auto speed = speeds[(size_t) ((tick - 1) / ticksPerSpeed) % std::size(speeds)];
+
+                sum += 0.5 * speed * tickSeconds;
+                sum -= std::floor(sum);
+                lfo.moveTo(tick * tickSeconds, speed);
+
+                worst = juce::jmax(worst, phaseDistance(lfo.getPhase(), sum));
+            }
+
+            expectLessThan(worst, 1.0e-9);
+        }
+
+        beginTest("Stepping through a day of ticks lands where one jump does");
+        {
+            DriftLfo stepped, jumped;
+            stepped.setPosition(0.8);
+            jumped.setPosition(0.8);
+
+            const int numTicks = (int) (24.0 * 3600.0 / tickSeconds);
+
+            for (int tick = 1; tick <= numTicks; ++tick)
+                stepped.moveTo(tick * tickSeconds, speeds[0]);
+
+            jumped.moveTo(numTicks * tickSeconds, speeds[0]);
+
+            expectLessThan(phaseDistance(stepped.getPhase(), jumped.getPhase()), 1.0e-9);
+        }
+
+        beginTest("Setting the phase or the speed keeps the sweep where it is");
+        {
+            DriftLfo lfo;
+            lfo.moveTo(12.5, speeds[2]);
+            lfo.setPhase(0.6);
+            expectLessThan(phaseDistance(lfo.getPhase(), 0.6), 1.0e-12);
+
+            lfo.moveTo(12.5, speeds[1]);
+            expectLessThan(phaseDistance(lfo.getPhase(), 0.6), 1.0e-12);
+
+            lfo.rebaseTime(1000.0);
+            lfo.moveTo(1001.0, speeds[1]);
+            expectLessThan(phaseDistance(lfo.getPhase(), 0.6 + 0.5 * speeds[1]), 1.0e-12);
+        }
+
+        beginTest("A phase set at another time carries on from that time");
+        {
+            // A fresh sweep, as on a reloaded instance, knows neither the time nor the speed.
+            DriftLfo lfo;
+            lfo.setPhase(0.3, 100.0);
+            lfo.moveTo(130.0, speeds[0]);
+            expectLessThan(phaseDistance(lfo.getPhase(), 0.3 + 0.5 * speeds[0] * 30.0), 1.0e-12);
+
+            DriftLfo moving;
+            moving.moveTo(5.0, speeds[0]);
+            moving.setPhase(0.3, 100.0);
+            moving.moveTo(70.0, speeds[0]);
+            expectLessThan(phaseDistance(moving.getPhase(), 0.3 - 0.5 * speeds[0] * 30.0), 1.0e-12);
+        }
+
+        beginTest("Positions trace a triangle");
+        {
+            DriftLfo lfo;
+
+            for (const auto phase : { 0.0, 0.125, 0.25, 0.5, 0.75, 0.9 })
+            {
+                lfo.setPhase(phase);
+                const auto expected = phase < 0.5 ? 2.0 * phase : 2.0 - 2.0 * phase;
+                expectWithinAbsoluteError((double) lfo.getPosition(), expected, 1.0e-6);
+            }
+        }
+    }
+};
+
+static DriftTest driftTest;
+
+//==============================================================================
+class BandLayoutTest  : public juce::UnitTest
+{
+public:
+    BandLayoutTest() : juce::UnitTest("Band layouts", "Echidna") {}
+
+    void runTest() override
+    {
+        beginTest("Banks of 3, 5 and 8 bands design the bands they share alike");
+        {
+            EQBandBank<3> bank3;
+            EQBandBank<5> bank5;
+            EQBandBank<8> bank8;
+
+            BiquadCoefficients<float> float3[3], float5[5], float8[8];
+            BiquadCoefficients<double> double3[3], double5[5], double8[8];
+
+            setUpBands(bank3);
+            setUpBands(bank5);
+            setUpBands(bank8);
+
+            bank3.designCoefficients(sampleRate, float3, nullptr);
+            bank5.designCoefficients(sampleRate, float5, nullptr);
+            bank8.designCoefficients(sampleRate, float8, nullptr);
+
+            setUpBands(bank3);
+            setUpBands(bank5);
+            setUpBands(bank8);
+
+            bank3.designCoefficients(sampleRate, double3);
+            bank5.designCoefficients(sampleRate, double5);
+            bank8.designCoefficients(sampleRate, double8);
+
+            for (int band = 0; band < 3; ++band)
+            {
+                expectCoefficientsMatch(float5[band], float3[band]);
+                expectCoefficientsMatch(float8[band], float3[band]);
+                expectCoefficientsMatch(double5[band], double3[band]);
+                expectCoefficientsMatch(double8[band], double3[band]);
+
+                expect(bank5.isTransparent(band) == bank3.isTransparent(band));
+                expect(bank8.isTransparent(band) == bank3.isTransparent(band));
+            }
+        }
+
+        beginTest("Disabled stages leave a longer cascade sounding like a shorter one");
+        {
+            constexpr int numChannels = 2;
+            constexpr int length = 4096;
+
+            BiquadCascade<float, 3> shorter;
+            BiquadCascade<float, 8> longer;
+            shorter.prepare(sampleRate);
+            longer.prepare(sampleRate);
+
+            for (int stage = 0; stage < 8; ++stage)
+            {
+                BiquadCoefficients<double> c;
+                BiquadDesigner::design(c, stage % 3, sampleRate, 150.0 * (stage + 1), 0.8, stage % 2 == 0 ? 2.0 : 0.5);
+                const BiquadCoefficients<float> k { (float) c.b0, (float) c.b1, (float) c.b2, (float) c.a1, (float) c.a2 };
+
+                if (stage < 3)
+                    shorter.coefficients[stage] = k;
+                else
+                    longer.setStageEnabled(stage, false);
+
+                longer.coefficients[stage] = k;
+            }
+
+            shorter.snapToTargets();
+            longer.snapToTargets();
+
+            // Let the disabled stages fade all the way out before comparing.
+            std::vector<float> silence((size_t) sampleRate, 0.0f);
+            float* silentChannels[numChannels] = { silence.data(), silence.data() };
+            longer.process(silentChannels, 1, 0, (int) silence.size());
+            longer.reset();
+
+            std::vector<float> shortOutput[numChannels], longOutput[numChannels];
+            Noise noise;
+
+            for (int channel = 0; channel < numChannels; ++channel)
+            {
+                for (int n = 0; n < length; ++n)
+                    shortOutput[channel].push_back(noise.next());
+
+                longOutput[channel] = shortOutput[channel];
+            }
+
+            float* shortChannels[numChannels] = { shortOutput[0].data(), shortOutput[1].data() };
+            float* longChannels[numChannels] = { longOutput[0].data(), longOutput[1].data() };
+            shorter.process(shortChannels, numChannels, 0, length);
+            longer.process(longChannels, numChannels, 0, length);
+
+            float difference = 0.0f;
+
+            for (int channel = 0; channel < numChannels; ++channel)
+                for (int n = 0; n < length; ++n)
+                    difference = juce::jmax(difference, std::abs(shortOutput[channel][(size_t) n] - longOutput[channel][(size_t) n]));
+
+            expectLessThan(difference, 1.0e-5f);
+        }
+    }
+
+private:
+    /** The same first three bands in any bank, with the rest left alone. */
+    template <int NumBands>
+    static void setUpBands(EQBandBank<NumBands>& bank)
+    {
+        const float gains[] = { 2.0f, 0.5f, 1.0f };
+        const float frequencies[] = { 80.0f, 1200.0f, 9000.0f };
+
+        for (int band = 0; band < 3; ++band)
+        {
+            bank.type[band] = band;
+            bank.gainCurrent[band] = gains[band];
+            bank.prevGain[band] = gains[band];
+            bank.freqLog2Current[band] = std::log2(frequencies[band]);
+            bank.freqStatic[band] = frequencies[band];
+            bank.Q[band] = 0.9f;
+        }
+
+        bank.needsUpdate = EQBandBank<NumBands>::allBandsMask;
+    }
+
+    template <typename CoefficientType>
+    void expectCoefficientsMatch(const BiquadCoefficients<CoefficientType>& actual, const BiquadCoefficients<CoefficientType>& expected)
+    {
+        expectEquals(actual.b0, expected.b0);
+        expectEquals(actual.b1, expected.b1);
+        expectEquals(actual.b2, expected.b2);
+        expectEquals(actual.a1, expected.a1);
+        expectEquals(actual.a2, expected.a2);
+    }
+};
+
+static BandLayoutTest bandLayoutTest;
+
+//==============================================================================
+namespace
+{
+    void setParameter(EchidnaAudioProcessor& processor, const juce::String& paramID, float value)
+    {
+        auto* parameter = processor.getValueTreeState().getParameter(paramID);
+        jassert(parameter != nullptr);
+        parameter->setValueNotifyingHost(parameter->convertTo0to1(value));
+    }
+
+    float getParameter(EchidnaAudioProcessor& processor, const juce::String& paramID)
+    {
+        auto* parameter = processor.getValueTreeState().getParameter(paramID);
+        jassert(parameter != nullptr);
+        return parameter->convertFrom0to1(parameter->getValue());
+    }
+
+    /** The binary state, split into the fields getStateInformation writes. */
+    struct SavedState
+    {
+        int magic = 0, version = 0, numBands = 0, numParameters = 0;
+        double driftTime = 0.0;         // from version 2
+        std::vector<double> phases;     // gain then freq phase, band by band
+        std::vector<float> slotValues;  // slot by slot, band by band, parameter by parameter
+        juce::ValueTree tree;
+
+        static SavedState read(const juce::MemoryBlock& block)
+        {
+            juce::MemoryInputStream stream(block, false);
+            SavedState state;
+            state.magic = stream.readInt();
+            state.version = stream.readInt();
+            state.numBands = stream.readInt();
+            state.numParameters = stream.readInt();
+
+            if (state.version >= 2)
+                state.driftTime = stream.readDouble();
+
+            for (int i = 0; i < 2 * state.numBands; ++i)
+                state.phases.push_back(stream.readDouble());
+
+            for (int i = 0; i < EchidnaAudioProcessor::numSnapshotSlots * state.numBands * state.numParameters; ++i)
+                state.slotValues.push_back(stream.readFloat());
+
+            state.tree = juce::ValueTree::readFromStream(stream);
+            return state;
+        }
+
+        static SavedState read(EchidnaAudioProcessor& processor)
+        {
+            juce::MemoryBlock block;
+            processor.getStateInformation(block);
+            return read(block);
+        }
+
+        juce::MemoryBlock write() const
+        {
+            juce::MemoryBlock block;
+            juce::MemoryOutputStream stream(block, false);
+            stream.writeInt(magic);
+            stream.writeInt(version);
+            stream.writeInt(numBands);
+            stream.writeInt(numParameters);
+
+            if (version >= 2)
+                stream.writeDouble(driftTime);
+
+            for (const auto phase : phases)
+                stream.writeDouble(phase);
+
+            for (const auto value : slotValues)
+                stream.writeFloat(value);
+
+            tree.writeToStream(stream);
+            stream.flush();
+            return block;
+        }
+    };
+
+    /** A transport that plays from wherever it is put. */
+    class TestPlayHead  : public juce::AudioPlayHead
+    {
+    public:
+        juce::Optional<PositionInfo> getPosition() const override
+        {
+            PositionInfo info;
+            info.setIsPlaying(true);
+            info.setTimeInSamples(position);
+            info.setTimeInSeconds((double) position / sampleRate);
+            info.setBpm(120.0);
+            info.setPpqPosition((double) position / sampleRate * 2.0);
+            return info;
+        }
+
+        juce::int64 position = 0;
+    };
+
+    /** Runs one block of noise at the given transport position. */
+    void processBlockAt(EchidnaAudioProcessor& processor, TestPlayHead& playHead, juce::int64 position, int blockSize)
+    {
+        const auto numChannels = juce::jmax(processor.getTotalNumInputChannels(), processor.getTotalNumOutputChannels());
+        juce::AudioBuffer<float> buffer(numChannels, blockSize);
+        juce::MidiBuffer midi;
+        Noise noise;
+
+        for (int channel = 0; channel < numChannels; ++channel)
+            for (int n = 0; n < blockSize; ++n)
+                buffer.setSample(channel, n, noise.next());
+
+        playHead.position = position;
+        processor.processBlock(buffer, midi);
+    }
+}
+
+//==============================================================================
+class ResponseCurveTest  : public juce::UnitTest
+{
+public:
+    ResponseCurveTest() : juce::UnitTest("Response curve", "Echidna") {}
+
+    void runTest() override
+    {
+        using namespace BiquadDesigner;
+        constexpr int numPoints = 256;
+
+        std::vector<double> frequencies, sinSquaredHalfOmega;
+
+        for (int i = 0; i < numPoints; ++i)
+        {
+            frequencies.push_back(ResponseCurve::minFrequency * std::pow(ResponseCurve::maxFrequency / ResponseCurve::minFrequency,
+                                                                         i / (double) (numPoints - 1)));
+            sinSquaredHalfOmega.push_back(juce::square(std::sin(juce::MathConstants<double>::pi * frequencies.back() / sampleRate)));
+        }
+
+        for (const auto type : { bell, lowShelf, highShelf, lowPass, highPass })
+        {
+            beginTest(juce::String(typeNames[type]) + " curves match the designs down to the lowest bands");
+
+            for (const auto frequency : { 20.0, 50.0, 100.0, 300.0, 1000.0, 10000.0 })
+            {
+                for (const auto Q : { 0.7, 4.0 })
+                {
+                    for (const auto gain : { 0.25, 4.0 })
+                    {
+                        BiquadCoefficients<double> c;
+                        design(c, type, sampleRate, frequency, Q, gain);
+
+                        std::vector<float> decibels((size_t) numPoints, 0.0f);
+                        ResponseCurve::addBandDecibels(c, sinSquaredHalfOmega.data(), decibels.data(), numPoints);
+
+                        double worst = 0.0;
+
+                        // Far down a pass filter's stop band, the float decibels run out before the design does.
+                        for (int i = 0; i < numPoints; ++i)
+                        {
+                            const auto expected = juce::Decibels::gainToDecibels(getMagnitudeForFrequency(c, frequencies[(size_t) i], sampleRate), -200.0);
+
+                            if (expected > -120.0)
+                                worst = juce::jmax(worst, std::abs((double) decibels[(size_t) i] - expected));
+                        }
+
+                        expectLessThan(worst, 0.001, juce::String(frequency) + " Hz, Q " + juce::String(Q) + ", gain " + juce::String(gain));
+                    }
+                }
+            }
+        }
+    }
+};
+
+static ResponseCurveTest responseCurveTest;
+
+//==============================================================================
+class TopologyTest  : public juce::UnitTest
+{
+public:
+    TopologyTest() : juce::UnitTest("Filter topology", "Echidna") {}
+
+    void runTest() override
+    {
+        beginTest("The SVFs report the tail of the designs they run, whichever design is chosen");
+
+        const auto tailWith = [](float filterDesign)
+        {
+            EchidnaAudioProcessor processor;
+            setParameter(processor, "FILTER_TOPOLOGY", 1.0f);
+            setParameter(processor, "FILTER_DESIGN", filterDesign);
+            setParameter(processor, "BAND1_GAIN", 8.0f);
+            setParameter(processor, "BAND1_FREQ", 15000.0f);
+            setParameter(processor, "BAND1_Q", 6.0f);
+
+            TestPlayHead playHead;
+            processor.setPlayHead(&playHead);
+            processor.setRateAndBufferSizeDetails(sampleRate, 480);
+            processor.prepareToPlay(sampleRate, 480);
+            processBlockAt(processor, playHead, 0, 480);
+            return processor.getTailLengthSeconds();
+        };
+
+        const auto bilinearTail = tailWith(0.0f);
+        expectGreaterThan(bilinearTail, 0.0);
+        expectEquals(tailWith(1.0f), bilinearTail);
+    }
+};
+
+static TopologyTest topologyTest;
+
+//==============================================================================
+class SilenceTest  : public juce::UnitTest
+{
+public:
+    SilenceTest() : juce::UnitTest("Silence and tails", "Echidna") {}
+
+    void runTest() override
+    {
+        constexpr int blockSize = 480;
+
+        EchidnaAudioProcessor processor;
+        TestPlayHead playHead;
+        processor.setPlayHead(&playHead);
+        processor.setRateAndBufferSizeDetails(sampleRate, blockSize);
+        processor.prepareToPlay(sampleRate, blockSize);
+
+        for (int band = 1; band <= EchidnaAudioProcessor::numBands; ++band)
+            setParameter(processor, "BAND" + juce::String(band) + "_GAIN", 1.0f);
+
+        beginTest("Bands at unity report no tail");
+        processBlockAt(processor, playHead, 0, blockSize);
+        expectEquals(processor.getTailLengthSeconds(), 0.0);
+
+        beginTest("The tail grows as a band rings longer");
+        setParameter(processor, "BAND1_FREQ", 40.0f);
+        setParameter(processor, "BAND1_GAIN", 4.0f);
+        setParameter(processor, "BAND1_Q", 1.0f);
+        processBlockAt(processor, playHead, blockSize, blockSize);
+        const auto broadTail = processor.getTailLengthSeconds();
+        expectGreaterThan(broadTail, 0.0);
+
+        setParameter(processor, "BAND1_Q", 10.0f);
+        processBlockAt(processor, playHead, 2 * blockSize, blockSize);
+        const auto tail = processor.getTailLengthSeconds();
+        expectGreaterThan(tail, 5.0 * broadTail);
+
+        beginTest("Silence in rings out within the tail, then is exact silence out, with no denormals on the way");
+        {
+            const auto numChannels = juce::jmax(processor.getTotalNumInputChannels(), processor.getTotalNumOutputChannels());
+            const auto tailBlocks = (int) std::ceil(tail * sampleRate / blockSize);
+            juce::AudioBuffer<float> buffer(numChannels, blockSize);
+            juce::MidiBuffer midi;
+            float firstPeak = 0.0f, peakAfterTail = 0.0f, peakAfterSkip = 0.0f;
+            int numDenormals = 0;
+
+            processBlockAt(processor, playHead, 3 * blockSize, blockSize);
+
+            // The tail is where the ringing has fallen 120 dB. The cascade is
+            // skipped once its delay lines are below -140 dB, a sixth later.
+            for (int block = 0; block < 2 * tailBlocks; ++block)
+            {
+                buffer.clear();
+                playHead.position = (juce::int64) (block + 4) * blockSize;
+                processor.processBlock(buffer, midi);
+
+                for (int channel = 0; channel < numChannels; ++channel)
+                    for (int n = 0; n < blockSize; ++n)
+                        if (std::fpclassify(buffer.getSample(channel, n)) == FP_SUBNORMAL)
+                            ++numDenormals;
+
+                const auto peak = buffer.getMagnitude(0, 0, blockSize);
+
+                if (block == 0)
+                    firstPeak = peak;
+                else if (block >= tailBlocks * 3 / 2)
+                    peakAfterSkip = juce::jmax(peakAfterSkip, peak);
+                else if (block >= tailBlocks)
+                    peakAfterTail = juce::jmax(peakAfterTail, peak);
+            }
+
+            expectGreaterThan(firstPeak, 0.0f, "the band's ringing was cut off");
+            expectLessThan(peakAfterTail, 1.0e-5f);
+            expectEquals(peakAfterSkip, 0.0f);
+            expectEquals(numDenormals, 0);
+        }
+    }
+};
+
+static SilenceTest silenceTest;
+
+//==============================================================================
+class LatencyTest  : public juce::UnitTest
+{
+public:
+    LatencyTest() : juce::UnitTest("Reported latency", "Echidna") {}
+
+    void runTest() override
+    {
+        constexpr int blockSize = 480;
+        const auto engineLatency = LinearPhaseEngine::getKernelSize(sampleRate) / 2 + LinearPhaseEngine::partitionSize;
+
+        // Every band at unity gain, so the only thing left in the path is its delay.
+        const auto makeProcessor = []
+        {
+            auto processor = std::make_unique<EchidnaAudioProcessor>();
+
+            for (int band = 1; band <= EchidnaAudioProcessor::numBands; ++band)
+                setParameter(*processor, "BAND" + juce::String(band) + "_GAIN", 1.0f);
+
+            return processor;
+        };
+
+        const auto findImpulse = [](EchidnaAudioProcessor& processor, TestPlayHead& playHead)
+        {
+            const auto numChannels = juce::jmax(processor.getTotalNumInputChannels(), processor.getTotalNumOutputChannels());
+            juce::AudioBuffer<float> buffer(numChannels, blockSize);
+            juce::MidiBuffer midi;
+            int peakPosition = -1;
+            float peak = 0.0f;
+
+            // Long enough for the engine's first kernel to fade in before the impulse.
+            for (int block = 0; block < 40; ++block)
+            {
+                buffer.clear();
+
+                if (block == 20)
+                    for (int channel = 0; channel < numChannels; ++channel)
+                        buffer.setSample(channel, 0, 1.0f);
+
+                playHead.position = (juce::int64) block * blockSize;
+                processor.processBlock(buffer, midi);
+
+                for (int n = 0; n < blockSize; ++n)
+                {
+                    if (block >= 20 && std::abs(buffer.getSample(0, n)) > peak)
+                    {
+                        peak = std::abs(buffer.getSample(0, n));
+                        peakPosition = (block - 20) * blockSize + n;
+                    }
+                }
+            }
+
+            return peakPosition;
+        };
+
+        beginTest("No latency is reported before the engine can be set up");
+        auto processor = makeProcessor();
+        setParameter(*processor, "LINEAR_PHASE", 1.0f);
+        expectEquals(processor->getLatencySamples(), 0);
+
+        beginTest("Once it is, the impulse arrives exactly that late");
+        {
+            TestPlayHead playHead;
+            processor->setPlayHead(&playHead);
+            processor->setNonRealtime(true);
+            processor->setRateAndBufferSizeDetails(sampleRate, blockSize);
+            processor->prepareToPlay(sampleRate, blockSize);
+
+            expectEquals(processor->getLatencySamples(), engineLatency);
+            expectEquals(findImpulse(*processor, playHead), engineLatency);
+        }
+
+        beginTest("Switching linear phase off takes the latency and the delay away together");
+        {
+            TestPlayHead playHead;
+            processor->setPlayHead(&playHead);
+            setParameter(*processor, "LINEAR_PHASE", 0.0f);
+
+            expectEquals(processor->getLatencySamples(), 0);
+            expectEquals(findImpulse(*processor, playHead), 0);
+        }
+    }
+};
+
+static LatencyTest latencyTest;
+
+//==============================================================================
+class TransportDriftTest  : public juce::UnitTest
+{
+public:
+    TransportDriftTest() : juce::UnitTest("Drift against the transport", "Echidna") {}
+
+    void runTest() override
+    {
+        constexpr int blockSize = 480;
+        constexpr int numBlocks = 3000;
+
+        const auto makeProcessor = [](TestPlayHead& playHead)
+        {
+            auto processor = std::make_unique<EchidnaAudioProcessor>();
+
+            for (int band = 1; band <= EchidnaAudioProcessor::numBands; ++band)
+            {
+                const auto prefix = "BAND" + juce::String(band) + "_";
+                setParameter(*processor, prefix + "GAIN_MIN", 0.5f);
+                setParameter(*processor, prefix + "GAIN_MAX", 1.5f);
+                setParameter(*processor, prefix + "GAIN_SPEED", 0.1f * (float) band);
+                setParameter(*processor, prefix + "GAIN_DIRECTION", 1.0f);
+                setParameter(*processor, prefix + "FREQ_MIN", 100.0f);
+                setParameter(*processor, prefix + "FREQ_MAX", 1000.0f);
+                setParameter(*processor, prefix + "FREQ_SPEED", 0.03f * (float) band);
+                setParameter(*processor, prefix + "FREQ_DIRECTION", -1.0f);
+            }
+
+            processor->setPlayHead(&playHead);
+            processor->setRateAndBufferSizeDetails(sampleRate, blockSize);
+            processor->prepareToPlay(sampleRate, blockSize);
+            return processor;
+        };
+
+        const auto expectSamePhases = [this](EchidnaAudioProcessor& actual, EchidnaAudioProcessor& expected)
+        {
+            const auto actualPhases = SavedState::read(actual).phases;
+            const auto expectedPhases = SavedState::read(expected).phases;
+            expectEquals((int) actualPhases.size(), (int) expectedPhases.size());
+
+            for (size_t i = 0; i < juce::jmin(actualPhases.size(), expectedPhases.size()); ++i)
+                expectWithinAbsoluteError(actualPhases[i], expectedPhases[i], 1.0e-9);
+        };
+
+        TestPlayHead playedHead, jumpedHead;
+        auto played = makeProcessor(playedHead);
+        auto jumped = makeProcessor(jumpedHead);
+
+        beginTest("A jump in the transport lands where playing through does");
+        {
+            for (int block = 0; block < numBlocks; ++block)
+                processBlockAt(*played, playedHead, (juce::int64) block * blockSize, blockSize);
+
+            processBlockAt(*jumped, jumpedHead, 0, blockSize);
+            const auto startPhases = SavedState::read(*jumped).phases;
+            processBlockAt(*jumped, jumpedHead, (juce::int64) (numBlocks - 1) * blockSize, blockSize);
+
+            expectEquals((int) startPhases.size(), 2 * EchidnaAudioProcessor::numBands);
+            expect(SavedState::read(*played).phases != startPhases, "nothing drifted");
+            expectSamePhases(*jumped, *played);
+        }
+
+        beginTest("A reloaded session picks its sweeps up wherever the transport is");
+        {
+            juce::MemoryBlock saved;
+            played->getStateInformation(saved);
+
+            // Where it stopped, an hour on, and back near the start.
+            for (const auto block : { numBlocks, numBlocks + 360000, 10 })
+            {
+                const auto position = (juce::int64) block * blockSize;
+
+                TestPlayHead reloadedHead;
+                EchidnaAudioProcessor reloaded;
+                reloaded.setStateInformation(saved.getData(), (int) saved.getSize());
+                reloaded.setPlayHead(&reloadedHead);
+                reloaded.setRateAndBufferSizeDetails(sampleRate, blockSize);
+                reloaded.prepareToPlay(sampleRate, blockSize);
+
+                processBlockAt(reloaded, reloadedHead, position, blockSize);
+                processBlockAt(*played, playedHead, position, blockSize);
+                expectSamePhases(reloaded, *played);
+            }
+        }
+    }
+};
+
+static TransportDriftTest transportDriftTest;
+
+//==============================================================================
+class StateTest  : public juce::UnitTest
+{
+public:
+    StateTest() : juce::UnitTest("Saved state", "Echidna") {}
+
+    void runTest() override
+    {
+        constexpr int numBands = EchidnaAudioProcessor::numBands;
+        constexpr int numSlots = EchidnaAudioProcessor::numSnapshotSlots;
+        const auto& names = EchidnaAudioProcessor::bandParamNames;
+        const auto lastBand = "BAND" + juce::String(numBands) + "_";
+
+        // A processor with something other than the defaults in its
+        // parameters and in both snapshot slots.
+        EchidnaAudioProcessor source;
+        setParameter(source, "BAND1_GAIN", 3.5f);
+        setParameter(source, "BAND2_FREQ", 2500.0f);
+        setParameter(source, lastBand + "Q", 2.0f);
+        setParameter(source, lastBand + "TYPE", 2.0f);
+        source.storeSnapshot(0);
+        setParameter(source, "BAND1_GAIN", -4.0f);
+        source.storeSnapshot(1);
+
+        juce::MemoryBlock blob;
+        source.getStateInformation(blob);
+        const auto saved = SavedState::read(blob);
+
+        const auto expectParametersMatch = [&](EchidnaAudioProcessor& processor, int bandsToCheck)
+        {
+            for (int band = 0; band < bandsToCheck; ++band)
+                for (int index = 0; index < numEQBandParameters; ++index)
+                    expectEquals(getParameter(processor, names[(size_t) band].get(index)),
+                                 getParameter(source, names[(size_t) band].get(index)),
+                                 names[(size_t) band].get(index));
+        };
+
+        const auto restore = [](EchidnaAudioProcessor& processor, const juce::MemoryBlock& block)
+        {
+            processor.setStateInformation(block.getData(), (int) block.getSize());
+        };
+
+        beginTest("Parameters and snapshots survive a round trip");
+        {
+            expectEquals(saved.numBands, numBands);
+            expectEquals(saved.numParameters, (int) numEQBandParameters);
+
+            EchidnaAudioProcessor restored;
+            restore(restored, blob);
+
+            expectParametersMatch(restored, numBands);
+            expect(SavedState::read(restored).slotValues == saved.slotValues, "snapshot slots differ");
+        }
+
+        beginTest("A layout with more bands and parameters restores what fits");
+        {
+            constexpr int extraBands = 2, extraParameters = 3;
+
+            auto wider = saved;
+            wider.numBands += extraBands;
+            wider.numParameters += extraParameters;
+            wider.phases.clear();
+            wider.slotValues.clear();
+
+            for (int band = 0; band < wider.numBands; ++band)
+            {
+                wider.phases.push_back(band < numBands ? 0.1 * band : 0.9);
+                wider.phases.push_back(band < numBands ? 0.05 * band : 0.9);
+            }
+
+            for (int slot = 0; slot < numSlots; ++slot)
+                for (int band = 0; band < wider.numBands; ++band)
+                    for (int index = 0; index < wider.numParameters; ++index)
+                        wider.slotValues.push_back(band < numBands && index < numEQBandParameters
+                                                       ? saved.slotValues[(size_t) ((slot * numBands + band) * numEQBandParameters + index)]
+                                                       : 12345.0f);
+
+            EchidnaAudioProcessor restored;
+            restore(restored, wider.write());
+
+            expectParametersMatch(restored, numBands);
+            expect(SavedState::read(restored).slotValues == saved.slotValues, "snapshot slots differ");
+        }
+
+        beginTest("A layout with fewer bands restores the bands it has");
+        {
+            EchidnaAudioProcessor untouched, restored;
+            const auto defaults = SavedState::read(untouched);
+
+            auto narrower = saved;
+            narrower.numBands = 1;
+            narrower.phases.resize(2);
+            narrower.slotValues.clear();
+
+            for (int slot = 0; slot < numSlots; ++slot)
+                for (int index = 0; index < numEQBandParameters; ++index)
+                    narrower.slotValues.push_back(saved.slotValues[(size_t) (slot * numBands * numEQBandParameters + index)]);
+
+            restore(restored, narrower.write());
+            const auto slotValues = SavedState::read(restored).slotValues;
+
+            for (int slot = 0; slot < numSlots; ++slot)
+            {
+                for (int band = 0; band < numBands; ++band)
+                {
+                    for (int index = 0; index < numEQBandParameters; ++index)
+                    {
+                        const auto i = (size_t) ((slot * numBands + band) * numEQBandParameters + index);
+                        expectEquals(slotValues[i], band == 0 ? saved.slotValues[i] : defaults.slotValues[i]);
+                    }
+                }
+            }
+        }
+
+        beginTest("A newer version, a wrong magic number or truncated data changes nothing");
+        {
+            auto newer = saved;
+            ++newer.version;
+
+            auto foreign = saved;
+            foreign.magic = saved.magic ^ 0x20;
+
+            const juce::MemoryBlock truncated[] = { juce::MemoryBlock(blob.getData(), blob.getSize() / 2),
+                                                    juce::MemoryBlock(blob.getData(), 20),
+                                                    juce::MemoryBlock() };
+
+            std::vector<juce::MemoryBlock> rejected { newer.write(), foreign.write() };
+            rejected.insert(rejected.end(), std::begin(truncated), std::end(truncated));
+
+            for (const auto& block : rejected)
+            {
+                EchidnaAudioProcessor processor;
+                setParameter(processor, "BAND1_GAIN", -2.0f);
+                restore(processor, block);
+
+                expectEquals(getParameter(processor, "BAND1_GAIN"), -2.0f);
+                expectEquals(getParameter(processor, "BAND2_FREQ"), 1000.0f);
+            }
+        }
+
+        beginTest("Drift phases carry on from where they were saved");
+        {
+            // Drifting as slowly as the parameters allow, so one block barely moves them.
+            EchidnaAudioProcessor drifting;
+
+            for (int band = 1; band <= numBands; ++band)
+            {
+                const auto prefix = "BAND" + juce::String(band) + "_";
+                setParameter(drifting, prefix + "GAIN_MIN", 0.5f);
+                setParameter(drifting, prefix + "GAIN_MAX", 1.5f);
+                setParameter(drifting, prefix + "GAIN_SPEED", 0.001f);
+                setParameter(drifting, prefix + "GAIN_DIRECTION", 1.0f);
+                setParameter(drifting, prefix + "FREQ_MIN", 100.0f);
+                setParameter(drifting, prefix + "FREQ_MAX", 1000.0f);
+                setParameter(drifting, prefix + "FREQ_SPEED", 0.0001f);
+                setParameter(drifting, prefix + "FREQ_DIRECTION", 1.0f);
+            }
+
+            auto withPhases = SavedState::read(drifting);
+
+            for (size_t i = 0; i < withPhases.phases.size(); ++i)
+                withPhases.phases[i] = std::fmod(0.07 + 0.11 * (double) i, 1.0);
+
+            EchidnaAudioProcessor restored;
+            TestPlayHead playHead;
+            restored.setPlayHead(&playHead);
+            restore(restored, withPhases.write());
+
+            restored.setRateAndBufferSizeDetails(sampleRate, 480);
+            restored.prepareToPlay(sampleRate, 480);
+            processBlockAt(restored, playHead, 0, 480);
+
+            const auto phases = SavedState::read(restored).phases;
+
+            for (size_t i = 0; i < phases.size(); ++i)
+                expectWithinAbsoluteError(phases[i], withPhases.phases[i], 1.0e-3);
+        }
+    }
+};
+
+static StateTest stateTest;
+
+//==============================================================================
+class BuildLayoutTest  : public juce::UnitTest
+{
+public:
+    BuildLayoutTest() : juce::UnitTest("Band layout of this build", "Echidna") {}
+
+    void runTest() override
+    {
+        constexpr int numBands = EchidnaAudioProcessor::numBands;
+        constexpr int numGlobalParameters = 9;
+        constexpr int blockSize = 480;
+
+        EchidnaAudioProcessor processor;
+
+        beginTest("Every band has its parameters, and there are no others");
+        {
+            expectEquals(processor.getParameters().size(), numBands * (int) numEQBandParameters + numGlobalParameters);
+
+            for (int band = 0; band < numBands; ++band)
+                for (int index = 0; index < numEQBandParameters; ++index)
+                    expect(processor.getValueTreeState().getParameter(EchidnaAudioProcessor::bandParamNames[(size_t) band].get(index)) != nullptr);
+
+            expect(processor.getValueTreeState().getParameter("BAND" + juce::String(numBands + 1) + "_GAIN") == nullptr);
+            expectEquals(SavedState::read(processor).numBands, numBands);
+        }
+
+        beginTest("Parameters added since the first release come after the ones hosts already automate");
+        {
+            const auto indexOf = [&processor](const juce::String& paramID)
+            {
+                return processor.getValueTreeState().getParameter(paramID)->getParameterIndex();
+            };
+
+            // Each band's original block, then the original globals.
+            const auto numOriginalBandParameters = numBands * (int) dynamicIndex;
+
+            for (int band = 0; band < numBands; ++band)
+                for (int index = 0; index < dynamicIndex; ++index)
+                    expectEquals(indexOf(EchidnaAudioProcessor::bandParamNames[(size_t) band].get(index)), band * (int) dynamicIndex + index);
+
+            expectEquals(indexOf("CONTROL_INTERVAL"), numOriginalBandParameters);
+            expectEquals(indexOf("LINEAR_PHASE"), numOriginalBandParameters + 5);
+
+            // Then the dynamics, band by band, and the globals added after them.
+            for (int band = 0; band < numBands; ++band)
+                for (int index = dynamicIndex; index < numEQBandParameters; ++index)
+                    expectEquals(indexOf(EchidnaAudioProcessor::bandParamNames[(size_t) band].get(index)),
+                                 numOriginalBandParameters + 6 + band * (int) (numEQBandParameters - dynamicIndex) + (index - dynamicIndex));
+
+            expectEquals(indexOf("SIDECHAIN"), numBands * (int) numEQBandParameters + 6);
+            expectEquals(indexOf("FILTER_TOPOLOGY"), processor.getParameters().size() - 1);
+        }
+
+        beginTest("Every band can be switched on and the output stays finite");
+        {
+            for (int band = 1; band <= numBands; ++band)
+            {
+                const auto prefix = "BAND" + juce::String(band) + "_";
+                setParameter(processor, prefix + "GAIN", band % 2 == 0 ? 6.0f : -6.0f);
+                setParameter(processor, prefix + "FREQ", 60.0f * (float) (band * band));
+                setParameter(processor, prefix + "Q", 4.0f);
+            }
+
+            TestPlayHead playHead;
+            processor.setPlayHead(&playHead);
+            processor.setRateAndBufferSizeDetails(sampleRate, blockSize);
+            processor.prepareToPlay(sampleRate, blockSize);
+
+            const auto numChannels = juce::jmax(processor.getTotalNumInputChannels(), processor.getTotalNumOutputChannels());
+            juce::AudioBuffer<float> buffer(numChannels, blockSize);
+            juce::MidiBuffer midi;
+            Noise noise;
+            bool finite = true;
+            float peak = 0.0f;
+
+            for (int block = 0; block < 100; ++block)
+            {
+                for (int channel = 0; channel < numChannels; ++channel)
+                    for (int n = 0; n < blockSize; ++n)
+                        buffer.setSample(channel, n, noise.next());
+
+                playHead.position = (juce::int64) block * blockSize;
+                processor.processBlock(buffer, midi);
+
+                for (int channel = 0; channel < numChannels; ++channel)
+                {
+                    for (int n = 0; n < blockSize; ++n)
+                    {
+                        finite = finite && std::isfinite(buffer.getSample(channel, n));
+                        peak = juce::jmax(peak, std::abs(buffer.getSample(channel, n)));
+                    }
+                }
+            }
+
+            expect(finite, "non-finite output");
+            expectGreaterThan(peak, 0.0f);
+        }
+    }
+};
+
+static BuildLayoutTest buildLayoutTest;
+
+//==============================================================================
+int main(int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+    juce::ArgumentList args(argc, argv);
+
+    if (args.containsOption("--help|-h"))
+    {
+        std::cout << "Usage: EchidnaTests\n"
+                     "\n"
+                     "Runs every test and exits with 1 if any of them failed." << std::endl;
+        return 0;
+    }
+
+    std::cout << "Echidna tests, " << EchidnaAudioProcessor::numBands << " band build" << std::endl;
+
+    juce::UnitTestRunner runner;
+    runner.setAssertOnFailure(false);
+    runner.runTestsInCategory("Echidna");
+
+    int numFailures = 0;
+
+    for (int i = 0; i < runner.getNumResults(); ++i)
+        numFailures += runner.getResult(i)->failures;
+
+    return numFailures == 0 ? 0 : 1;
+}